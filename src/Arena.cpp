@@ -0,0 +1,149 @@
+/*
+ * Arena.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *
+ *  Bump allocator which hands out memory from large blocks, optionally
+ *  backed by huge pages, and frees all of it at once
+ *
+ */
+
+#include "Arena.h"
+
+
+/**
+ * Arena constructor. No memory is mapped until the first allocation
+ * @param name the name of the arena for the usage report
+ * @param block_size the size of the blocks to allocate from
+ */
+Arena::Arena(std::string name, size_t block_size) {
+	_name = name;
+	_block_size = block_size;
+	_huge_pages = false;
+	_bytes_used = 0;
+}
+
+
+/**
+ * Arena destructor unmaps all blocks
+ */
+Arena::~Arena() {
+	release();
+}
+
+
+/**
+ * Sets whether the blocks mapped from now on are backed by huge pages
+ * @param huge_pages whether or not to use huge pages
+ */
+void Arena::setHugePages(bool huge_pages) {
+	_huge_pages = huge_pages;
+}
+
+
+/**
+ * Maps a new block to allocate from. With huge pages the block is mapped
+ * from the reserved huge pages if there are enough of them, and otherwise
+ * transparent huge pages are requested for it. The pages are only placed
+ * in memory when they are first written, by the thread which writes them
+ * @param size the minimum size of the block
+ */
+void Arena::addBlock(size_t size) {
+
+	arena_block block;
+	block._size = std::max(size, _block_size);
+	block._used = 0;
+	block._start = (char*)MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+	if (_huge_pages)
+		block._start = (char*)mmap(NULL, block._size, PROT_READ | PROT_WRITE,
+						MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+
+	if (block._start == MAP_FAILED) {
+		block._start = (char*)mmap(NULL, block._size, PROT_READ | PROT_WRITE,
+									MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (block._start == MAP_FAILED)
+			log_printf(ERROR, "Unable to map a block of %ld bytes for the %s "
+							"arena", (long)block._size, _name.c_str());
+
+#ifdef MADV_HUGEPAGE
+		if (_huge_pages)
+			madvise(block._start, block._size, MADV_HUGEPAGE);
+#endif
+	}
+
+	_blocks.push_back(block);
+}
+
+
+/**
+ * Allocates memory from the current block, or from a new block if it is
+ * full. The memory cannot be freed on its own but only with the whole
+ * arena. This is not safe to call from several threads at once
+ * @param size the number of bytes to allocate
+ * @return a pointer to the memory, aligned for any type
+ */
+void* Arena::allocate(size_t size) {
+
+	size = (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+
+	if (_blocks.empty() || _blocks.back()._used + size > _blocks.back()._size)
+		addBlock(size);
+
+	arena_block& block = _blocks.back();
+	void* memory = block._start + block._used;
+	block._used += size;
+	_bytes_used += size;
+
+	return memory;
+}
+
+
+/**
+ * Frees all memory allocated from this arena and unmaps its blocks
+ */
+void Arena::release() {
+
+	for (unsigned int i = 0; i < _blocks.size(); i++)
+		munmap(_blocks[i]._start, _blocks[i]._size);
+
+	_blocks.clear();
+	_bytes_used = 0;
+}
+
+
+/**
+ * Returns the number of bytes allocated from this arena
+ * @return the number of bytes used
+ */
+size_t Arena::getBytesUsed() const {
+	return _bytes_used;
+}
+
+
+/**
+ * Returns the total size of the blocks mapped by this arena
+ * @return the number of bytes reserved
+ */
+size_t Arena::getBytesReserved() const {
+
+	size_t bytes = 0;
+
+	for (unsigned int i = 0; i < _blocks.size(); i++)
+		bytes += _blocks[i]._size;
+
+	return bytes;
+}
+
+
+/**
+ * Prints the number of bytes used and reserved by this arena
+ */
+void Arena::printUsage() const {
+	log_printf(NORMAL, "Arena %s: %.2f MB used of %.2f MB in %d blocks",
+			_name.c_str(), getBytesUsed() / 1048576.0,
+			getBytesReserved() / 1048576.0, (int)_blocks.size());
+}
@@ -0,0 +1,54 @@
+/*
+ * Arena.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ *  Bump allocator which hands out memory from large blocks, optionally
+ *  backed by huge pages, and frees all of it at once
+ *
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stddef.h>
+#include <sys/mman.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "log.h"
+
+/* Default size of the blocks the arena allocates from, a multiple of the
+ * 2 MB huge page size */
+#define ARENA_BLOCK_SIZE (16 << 20)
+
+/* Alignment of each allocation */
+#define ARENA_ALIGNMENT 16
+
+/* A block of memory mapped by an arena */
+struct arena_block {
+	char* _start;
+	size_t _size;
+	size_t _used;
+};
+
+class Arena {
+private:
+	std::string _name;
+	size_t _block_size;
+	bool _huge_pages;
+	std::vector<arena_block> _blocks;
+	size_t _bytes_used;
+	void addBlock(size_t size);
+public:
+	Arena(std::string name, size_t block_size=ARENA_BLOCK_SIZE);
+	virtual ~Arena();
+	void setHugePages(bool huge_pages);
+	void* allocate(size_t size);
+	void release();
+	size_t getBytesUsed() const;
+	size_t getBytesReserved() const;
+	void printUsage() const;
+};
+
+#endif /* ARENA_H_ */
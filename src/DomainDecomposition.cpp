@@ -0,0 +1,228 @@
+/*
+ * DomainDecomposition.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *
+ *  Decomposition of the geometry into a grid of rectangular subdomains,
+ *  one per MPI process, and the exchange of the angular fluxes crossing
+ *  the subdomain boundaries
+ *
+ */
+
+#include "DomainDecomposition.h"
+
+#if USE_MPI
+
+/**
+ * DomainDecomposition constructor. Process rank r owns the subdomain in
+ * column r % num_x and row r / num_x of the grid. If neither grid size is
+ * given, the processes are arranged in a grid which is as square as
+ * possible
+ * @param num_x the number of subdomains along x
+ * @param num_y the number of subdomains along y
+ */
+DomainDecomposition::DomainDecomposition(int num_x, int num_y) {
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &_num_ranks);
+
+	if (num_x <= 0 && num_y <= 0) {
+		num_x = (int)sqrt((double)_num_ranks);
+		while (_num_ranks % num_x != 0)
+			num_x--;
+		num_y = _num_ranks / num_x;
+	}
+
+	if (num_x * num_y != _num_ranks)
+		log_printf(ERROR, "Unable to decompose the geometry into %d x %d "
+				"subdomains for %d processes", num_x, num_y, _num_ranks);
+
+	_num_x = num_x;
+	_num_y = num_y;
+
+	log_printf(NORMAL, "Decomposing the geometry into %d x %d subdomains...",
+														_num_x, _num_y);
+}
+
+
+/**
+ * DomainDecomposition destructor deletes the ghost tracks
+ */
+DomainDecomposition::~DomainDecomposition() {
+	for (unsigned int i = 0; i < _ghost_tracks.size(); i++)
+		delete _ghost_tracks[i];
+}
+
+
+/**
+ * Returns the rank of this process
+ * @return the rank
+ */
+int DomainDecomposition::getRank() const {
+	return _rank;
+}
+
+
+/**
+ * Returns the number of processes, one per subdomain
+ * @return the number of processes
+ */
+int DomainDecomposition::getNumRanks() const {
+	return _num_ranks;
+}
+
+
+/**
+ * Returns the number of subdomains along x
+ * @return the number of subdomains along x
+ */
+int DomainDecomposition::getNumX() const {
+	return _num_x;
+}
+
+
+/**
+ * Returns the number of subdomains along y
+ * @return the number of subdomains along y
+ */
+int DomainDecomposition::getNumY() const {
+	return _num_y;
+}
+
+
+/**
+ * Adds a flux which leaves this subdomain for another process. The flux
+ * is written to a ghost track by the transport sweep and sent from there
+ * @param rank the process which owns the track the flux enters
+ * @param direction the half of the polar fluxes which is sent
+ * @return the ghost track to set as the outgoing track
+ */
+Track* DomainDecomposition::addSendFlux(int rank, bool direction) {
+
+	boundary_flux flux;
+	double zeros[GRP_TIMES_ANG] = {0.0};
+
+	flux._track = new Track();
+	flux._track->setValues(0.0, 0.0, 0.0, 0.0, 0.0);
+	flux._track->setPolarFluxes(false, 0, zeros);
+	flux._track->setPolarFluxes(true, 0, zeros);
+	flux._direction = direction;
+
+	_ghost_tracks.push_back(flux._track);
+	_send_fluxes[rank].push_back(flux);
+
+	return flux._track;
+}
+
+
+/**
+ * Adds a flux which enters a track in this subdomain from another process
+ * @param rank the process which sends the flux
+ * @param track the track which the flux enters
+ * @param direction the half of the track's polar fluxes which is set
+ */
+void DomainDecomposition::addReceiveFlux(int rank, Track* track,
+													bool direction) {
+	boundary_flux flux;
+	flux._track = track;
+	flux._direction = direction;
+	_recv_fluxes[rank].push_back(flux);
+}
+
+
+/**
+ * Moves the fluxes received for tracks which have been cut into pieces to
+ * the pieces they enter. A flux entering in the forward direction enters
+ * the first piece of its track and one in the reverse direction the last
+ * @param pieces the first and last piece of each track which has been cut
+ */
+void DomainDecomposition::replaceTracks(std::map<Track*,
+								std::pair<Track*, Track*> >& pieces) {
+
+	std::map<int, std::vector<boundary_flux> >::iterator iter;
+	std::map<Track*, std::pair<Track*, Track*> >::iterator piece;
+
+	for (iter = _recv_fluxes.begin(); iter != _recv_fluxes.end(); ++iter) {
+		for (unsigned int i = 0; i < iter->second.size(); i++) {
+			piece = pieces.find(iter->second[i]._track);
+			if (piece == pieces.end())
+				continue;
+
+			iter->second[i]._track = iter->second[i]._direction ?
+								piece->second.second : piece->second.first;
+		}
+	}
+}
+
+
+/**
+ * Sends the angular fluxes which left this subdomain in the last transport
+ * sweep to the neighbouring processes and sets the fluxes which entered
+ * this subdomain from them as the incoming fluxes of its tracks
+ */
+void DomainDecomposition::exchangeBoundaryFluxes() {
+
+	std::vector<MPI_Request> requests;
+	std::map<int, std::vector<boundary_flux> >::iterator iter;
+	std::vector<double>* buffer;
+	double* polar_fluxes;
+
+	for (iter = _recv_fluxes.begin(); iter != _recv_fluxes.end(); ++iter) {
+		buffer = &_recv_buffers[iter->first];
+		buffer->resize(iter->second.size() * GRP_TIMES_ANG);
+		requests.push_back(MPI_Request());
+		MPI_Irecv(&(*buffer)[0], buffer->size(), MPI_DOUBLE, iter->first, 0,
+									MPI_COMM_WORLD, &requests.back());
+	}
+
+	for (iter = _send_fluxes.begin(); iter != _send_fluxes.end(); ++iter) {
+		buffer = &_send_buffers[iter->first];
+		buffer->resize(iter->second.size() * GRP_TIMES_ANG);
+
+		for (unsigned int i = 0; i < iter->second.size(); i++) {
+			polar_fluxes = iter->second[i]._track->getPolarFluxes() +
+							iter->second[i]._direction * GRP_TIMES_ANG;
+			std::copy(polar_fluxes, polar_fluxes + GRP_TIMES_ANG,
+								buffer->begin() + i * GRP_TIMES_ANG);
+		}
+
+		requests.push_back(MPI_Request());
+		MPI_Isend(&(*buffer)[0], buffer->size(), MPI_DOUBLE, iter->first, 0,
+									MPI_COMM_WORLD, &requests.back());
+	}
+
+	MPI_Waitall(requests.size(), &requests[0], MPI_STATUSES_IGNORE);
+
+	for (iter = _recv_fluxes.begin(); iter != _recv_fluxes.end(); ++iter) {
+		buffer = &_recv_buffers[iter->first];
+
+		for (unsigned int i = 0; i < iter->second.size(); i++)
+			iter->second[i]._track->setPolarFluxes(
+						iter->second[i]._direction, i * GRP_TIMES_ANG,
+						&(*buffer)[0]);
+	}
+}
+
+
+/**
+ * Adds up an array over all processes, leaving the totals on each process
+ * @param values the array to add up
+ * @param num_values the length of the array
+ */
+void DomainDecomposition::sum(double* values, int num_values) {
+	MPI_Allreduce(MPI_IN_PLACE, values, num_values, MPI_DOUBLE, MPI_SUM,
+													MPI_COMM_WORLD);
+}
+
+
+/**
+ * Adds up an array over all processes, leaving the totals on each process
+ * @param values the array to add up
+ * @param num_values the length of the array
+ */
+void DomainDecomposition::sum(int* values, int num_values) {
+	MPI_Allreduce(MPI_IN_PLACE, values, num_values, MPI_INT, MPI_SUM,
+													MPI_COMM_WORLD);
+}
+
+#endif
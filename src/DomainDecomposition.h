@@ -0,0 +1,66 @@
+/*
+ * DomainDecomposition.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ *  Decomposition of the geometry into a grid of rectangular subdomains,
+ *  one per MPI process, and the exchange of the angular fluxes crossing
+ *  the subdomain boundaries
+ *
+ */
+
+#ifndef DOMAINDECOMPOSITION_H_
+#define DOMAINDECOMPOSITION_H_
+
+#include "configurations.h"
+
+#if USE_MPI
+
+#include <mpi.h>
+#include <math.h>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "Track.h"
+#include "log.h"
+
+/* Angular fluxes of a track which cross to or from another process. The
+ * direction is the half of the track's polar fluxes which is exchanged */
+struct boundary_flux {
+	Track* _track;
+	bool _direction;
+};
+
+class DomainDecomposition {
+private:
+	int _rank;
+	int _num_ranks;
+	int _num_x;
+	int _num_y;
+	/* Fluxes sent to and received from each neighbouring process, listed
+	 * in the same order by both processes */
+	std::map<int, std::vector<boundary_flux> > _send_fluxes;
+	std::map<int, std::vector<boundary_flux> > _recv_fluxes;
+	std::map<int, std::vector<double> > _send_buffers;
+	std::map<int, std::vector<double> > _recv_buffers;
+	/* Tracks which hold the fluxes leaving this subdomain until they are
+	 * sent to the neighbouring process */
+	std::vector<Track*> _ghost_tracks;
+public:
+	DomainDecomposition(int num_x, int num_y);
+	virtual ~DomainDecomposition();
+	int getRank() const;
+	int getNumRanks() const;
+	int getNumX() const;
+	int getNumY() const;
+	Track* addSendFlux(int rank, bool direction);
+	void addReceiveFlux(int rank, Track* track, bool direction);
+	void replaceTracks(std::map<Track*, std::pair<Track*, Track*> >& pieces);
+	void exchangeBoundaryFluxes();
+	void sum(double* values, int num_values);
+	void sum(int* values, int num_values);
+};
+
+#endif
+
+#endif /* DOMAINDECOMPOSITION_H_ */
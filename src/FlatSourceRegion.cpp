@@ -10,35 +10,31 @@
 #include "FlatSourceRegion.h"
 
 /**
- * FlatSourceRegion constructor
+ * FlatSourceRegion constructor. The region's flux and source arrays must
+ * be set with setStorage before they are used
  */
 FlatSourceRegion::FlatSourceRegion() {
 
 	_material = NULL;
 	_volume = 0.0;
-
-	/* Zero the region's flux and source */
-	for (int e = 0; e < NUM_ENERGY_GROUPS; e++) {
-		_flux[e] = 0.0;
-		_old_flux[e] = 0.0;
-		_source[e] = 0.0;
-		_old_source[e] = 0.0;
-	}
+	_flux = NULL;
+	_old_flux = NULL;
+	_source = NULL;
+	_old_source = NULL;
+	_ratios = NULL;
+	_stride = 1;
 
 #if USE_OPENMP
-	omp_init_lock(&_flux_lock);
+	_flux_lock = NULL;
 #endif
 }
 
 
 /**
- * Default destructor
+ * Default destructor. The flux and source arrays and the lock are owned
+ * by the Solver
  */
-FlatSourceRegion::~FlatSourceRegion() {
-#if USE_OPENMP
-	omp_destroy_lock(&_flux_lock);
-#endif
-}
+FlatSourceRegion::~FlatSourceRegion() { }
 
 /**
  * Returns this region's id. This id must correspond to the id computed
@@ -70,7 +66,8 @@ double FlatSourceRegion::getVolume() const {
 
 
 /**
- * Returns an array of the multi energy group fluxes tallied in this region
+ * Returns an array of the multi energy group fluxes tallied in this region.
+ * The flux for energy group e is at index e * getStride()
  * @return a flux array
  */
 double* FlatSourceRegion::getFlux() {
@@ -118,6 +115,16 @@ double* FlatSourceRegion::getRatios() {
 }
 
 
+/**
+ * Returns the distance between the values for consecutive energy groups in
+ * this region's flux, source and ratio arrays
+ * @return the stride between energy groups
+ */
+int FlatSourceRegion::getStride() const {
+	return _stride;
+}
+
+
 /**
  * Sets this region's id
  * @param id the region id
@@ -145,6 +152,39 @@ void FlatSourceRegion::setVolume(double volume) {
 }
 
 
+/**
+ * Sets the arrays which hold this region's fluxes, sources and source /
+ * sigma_t ratios. Each array points to energy group 0 for this region and
+ * the value for energy group e is at index e * stride
+ * @param flux the scalar flux array
+ * @param old_flux the old scalar flux array
+ * @param source the source array
+ * @param old_source the old source array
+ * @param ratios the source / sigma_t ratio array
+ * @param stride the distance between consecutive energy groups
+ */
+void FlatSourceRegion::setStorage(double* flux, double* old_flux,
+				double* source, double* old_source, double* ratios, int stride) {
+	_flux = flux;
+	_old_flux = old_flux;
+	_source = source;
+	_old_source = old_source;
+	_ratios = ratios;
+	_stride = stride;
+}
+
+
+#if USE_OPENMP
+/**
+ * Sets the lock which guards increments to this region's scalar flux
+ * @param flux_lock a pointer to an initialized lock
+ */
+void FlatSourceRegion::setFluxLock(omp_lock_t* flux_lock) {
+	_flux_lock = flux_lock;
+}
+#endif
+
+
 /**
  * Increment this FSR's volume by some amount corresponding to a segment length
  * @param volume the amount to increment by
@@ -164,7 +204,7 @@ void FlatSourceRegion::setFlux(int energy, double flux) {
 		log_printf(ERROR, "Attempted to set the scalar flux for FSR id = %d "
 				"in an energy group which does not exist: %d", _id, energy);
 
-	_flux[energy] = flux;
+	_flux[energy * _stride] = flux;
 	return;
 }
 
@@ -176,17 +216,17 @@ void FlatSourceRegion::setFlux(int energy, double flux) {
  */
 void FlatSourceRegion::incrementFlux(int energy, double flux) {
 #if USE_OPENMP
-	omp_set_lock(&_flux_lock);
+	omp_set_lock(_flux_lock);
 #endif
 
 	if (energy < -1 || energy >= NUM_ENERGY_GROUPS)
 		log_printf(ERROR, "Attempted to increment the scalar flux for FSR id = "
 				"%d in an energy group which does not exist: %d", _id, energy);
 
-	_flux[energy] += flux;
+	_flux[energy * _stride] += flux;
 
 #if USE_OPENMP
-	omp_unset_lock(&_flux_lock);
+	omp_unset_lock(_flux_lock);
 #endif
 
 	return;
@@ -199,14 +239,14 @@ void FlatSourceRegion::incrementFlux(int energy, double flux) {
  */
 void FlatSourceRegion::incrementFlux(double* flux) {
 #if USE_OPENMP
-	omp_set_lock(&_flux_lock);
+	omp_set_lock(_flux_lock);
 #endif
 
 	for (int e=0; e < NUM_ENERGY_GROUPS; e++)
-		_flux[e] += flux[e];
+		_flux[e * _stride] += flux[e];
 
 #if USE_OPENMP
-	omp_unset_lock(&_flux_lock);
+	omp_unset_lock(_flux_lock);
 #endif
 
 	return;
@@ -224,7 +264,7 @@ void FlatSourceRegion::setOldFlux(int energy, double old_flux) {
 		log_printf(ERROR, "Attempted to set the old scalar flux for FSR id = %d "
 				"in an energy group which does not exist: %d", _id, energy);
 
-	_old_flux[energy] = old_flux;
+	_old_flux[energy * _stride] = old_flux;
 	return;
 }
 
@@ -239,7 +279,7 @@ void FlatSourceRegion::setSource(int energy, double source) {
 		log_printf(ERROR, "Attempted to set the source for FSR id = %d "
 				"in an energy group which does not exist: %d", _id, energy);
 
-	_old_source[energy] = source;
+	_old_source[energy * _stride] = source;
 	return;
 }
 
@@ -255,7 +295,7 @@ void FlatSourceRegion::setOldSource(int energy, double old_source) {
 		log_printf(ERROR, "Attempted to set the old source for FSR id = %d "
 				"in an energy group which does not exist: %d", _id, energy);
 
-	_old_source[energy] = old_source;
+	_old_source[energy * _stride] = old_source;
 	return;
 }
 
@@ -268,7 +308,7 @@ void FlatSourceRegion::normalizeFluxes(double factor) {
 
 	/* Loop over all energy groups */
 	for (int e=0; e < NUM_ENERGY_GROUPS; e++)
-		_flux[e] *= factor;
+		_flux[e * _stride] *= factor;
 
 	return;
 }
@@ -282,7 +322,7 @@ void FlatSourceRegion::computeRatios() {
 	double* sigma_t = _material->getSigmaT();
 
 	for (int e = 0; e < NUM_ENERGY_GROUPS; e++) {
-		_ratios[e] = _source[e]/sigma_t[e];
+		_ratios[e * _stride] = _source[e * _stride]/sigma_t[e];
 	}
 
 	return;
@@ -302,7 +342,7 @@ double FlatSourceRegion::computeFissionRate() {
 
 	/* Add the fission rates from each energy group */
 	for (int e=0; e < NUM_ENERGY_GROUPS; e++)
-		power += sigma_f[e] * _flux[e];
+		power += sigma_f[e] * _flux[e * _stride];
 
 	/* Multiply by volume of FSR */
 	power *= _volume;
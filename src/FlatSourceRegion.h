@@ -18,19 +18,22 @@
 	#include <omp.h>
 #endif
 
+/* A view of one region's state inside arrays owned by the Solver. The
+ * value for energy group e is found at index e * stride of each array */
 class FlatSourceRegion {
 private:
 	int _id;
 	Material* _material;
 	double _volume;
-	double _flux[NUM_ENERGY_GROUPS];
-	double _old_flux[NUM_ENERGY_GROUPS];
-	double _source[NUM_ENERGY_GROUPS];
-	double _old_source[NUM_ENERGY_GROUPS];
+	double* _flux;
+	double* _old_flux;
+	double* _source;
+	double* _old_source;
 	/* Pre-computed Ratio of source / sigma_t */
-	double _ratios[NUM_ENERGY_GROUPS];
+	double* _ratios;
+	int _stride;
 #if USE_OPENMP
-	omp_lock_t _flux_lock;
+	omp_lock_t* _flux_lock;
 #endif
 public:
 	FlatSourceRegion();
@@ -43,9 +46,15 @@ public:
     double* getOldSource();
     double* getSource();
     double* getRatios();
+    int getStride() const;
     void setId(int id);
     void setMaterial(Material* material);
     void setVolume(double volume);
+    void setStorage(double* flux, double* old_flux, double* source,
+    				double* old_source, double* ratios, int stride);
+#if USE_OPENMP
+    void setFluxLock(omp_lock_t* flux_lock);
+#endif
     void incrementVolume(double volume);
     void setFlux(int energy, double flux);
     void incrementFlux(int energy, double flux);
@@ -76,6 +76,7 @@ Geometry::Geometry(Parser* parser) {
 	}
 
 	_mesh = new Mesh;
+	_segment_arena = new Arena("segments");
 }
 
 
@@ -109,6 +110,8 @@ Geometry::~Geometry() {
 		delete iter4->second;
 	_universes.clear();
 	_lattices.clear();
+
+	delete _segment_arena;
 }
 
 /**
@@ -203,6 +206,38 @@ Material* Geometry::getMaterial(int id) {
 }
 
 
+/**
+ * Checks whether the geometry has a material with a given id
+ * @param id the material id
+ * @return whether or not the material exists
+ */
+bool Geometry::hasMaterial(int id) {
+	return mapContainsKey(_materials, id);
+}
+
+
+/**
+ * Replaces the cross-sections of the material with the same id as a given
+ * material. The cells filled by the material are left unchanged, so the
+ * FSRs and tracks remain valid
+ * @param material the material to copy the cross-sections from
+ * @return the geometry's material if its cross-sections changed, else NULL
+ */
+Material* Geometry::updateMaterial(Material* material) {
+
+	Material* old = getMaterial(material->getId());
+
+	/* Check that the sum of the new absorption and scattering
+	 * cross-sections equals the new total cross-section */
+	material->checkSigmaT();
+
+	if (old->setCrossSections(material))
+		return old;
+
+	return NULL;
+}
+
+
 /**
  * Return an array indexed by FSR ids which contains the corresponding cell ids
  * @return an array map of FSR to cell ids
@@ -1725,6 +1760,10 @@ void Geometry::segmentize(Track* track) {
 	/* Length of each segment */
 	double segment_length;
 
+	/* Length of the track left to segment, since a track which has been cut
+	 * at a subdomain boundary ends inside the geometry */
+	double length_left = track->getStart()->distance(track->getEnd());
+
 	/* Use a LocalCoords for the start and end of each segment */
 	LocalCoords segment_start(x0, y0);
 	LocalCoords segment_end(x0, y0);
@@ -1734,6 +1773,7 @@ void Geometry::segmentize(Track* track) {
 	/* Find the cell for the track starting point */
 	Cell* curr = findFirstCell(&segment_end, phi);
 	Cell* prev;
+	int fsr_id;
 
 	/* If starting point was outside the bounds of the geometry */
 	if (curr == NULL)
@@ -1753,8 +1793,17 @@ void Geometry::segmentize(Track* track) {
 		/* Find the segment length between the segments start and end points */
 		segment_length = segment_end.getPoint()->distance(segment_start.getPoint());
 
+		/* Stop at the end point of the track */
+		if (segment_length > length_left - ON_SURFACE_THRESH) {
+			segment_length = std::min(segment_length, length_left);
+			curr = NULL;
+		}
+
+		length_left -= segment_length;
+
 		/* Create a new segment */
-		segment* new_segment = new segment;
+		segment* new_segment = new (_segment_arena->allocate(sizeof(segment)))
+																segment;
 		new_segment->_length = segment_length;
 		new_segment->_material = _materials.at(static_cast<CellBasic*>(prev)->getMaterial());
 
@@ -1768,10 +1817,12 @@ void Geometry::segmentize(Track* track) {
 				segment_start.getX(), segment_start.getY(), segment_end.getX(),
 				segment_end.getY());
 
-		new_segment->_region_id = findFSRId(&segment_start);
+		fsr_id = findFSRId(&segment_start);
+		new_segment->_region_id = getInternalFSRId(fsr_id);
+		indexLatticeCells(&segment_start, track);
 #if CMFD_ACCEL
-		new_segment->_mesh_surface_fwd = _mesh->findMeshSurface(new_segment->_region_id, &segment_end);
-		new_segment->_mesh_surface_bwd = _mesh->findMeshSurface(new_segment->_region_id, &segment_start);
+		new_segment->_mesh_surface_fwd = _mesh->findMeshSurface(fsr_id, &segment_end);
+		new_segment->_mesh_surface_bwd = _mesh->findMeshSurface(fsr_id, &segment_start);
 #endif
 
 		/* Checks to make sure that new segment does not have the same start
@@ -1801,6 +1852,142 @@ void Geometry::segmentize(Track* track) {
 }
 
 
+/**
+ * Returns the arena which segmentize allocates the segments from. The
+ * segments are freed together when the arena is released
+ * @return a pointer to the segment arena
+ */
+Arena* Geometry::getSegmentArena() const {
+	return _segment_arena;
+}
+
+
+/**
+ * Adds a track to the index of tracks which cross each lattice cell, for
+ * each of the lattice cells at every level of a localcoords object
+ * @param coords a localcoords object returned from the findCell method
+ * @param track the track which crosses the lattice cells
+ */
+void Geometry::indexLatticeCells(LocalCoords* coords, Track* track) {
+
+	LocalCoords* curr = coords;
+	Lattice* lattice;
+
+	while (curr != NULL) {
+		if (curr->getType() == LAT) {
+			lattice = _lattices.at(curr->getLattice());
+			std::vector< std::set<Track*> >& cells =
+									_lattice_cell_tracks[curr->getLattice()];
+
+			if (cells.empty())
+				cells.resize(lattice->getNumX() * lattice->getNumY());
+
+			cells[curr->getLatticeY() * lattice->getNumX() +
+									curr->getLatticeX()].insert(track);
+		}
+		curr = curr->getNext();
+	}
+
+	return;
+}
+
+
+/**
+ * Returns the tracks which cross a lattice cell. If the lattice fills more
+ * than one cell, the tracks which cross the lattice cell in any of them are
+ * returned
+ * @param lattice_id the lattice id
+ * @param lattice_x the x index of the lattice cell
+ * @param lattice_y the y index of the lattice cell
+ * @return the tracks which cross the lattice cell
+ */
+std::vector<Track*> Geometry::getLatticeCellTracks(int lattice_id,
+										int lattice_x, int lattice_y) {
+
+	std::vector<Track*> tracks;
+	Lattice* lattice = getLattice(lattice_id);
+
+	if (_lattice_cell_tracks.find(lattice_id) == _lattice_cell_tracks.end()
+			|| lattice_x < 0 || lattice_x >= lattice->getNumX()
+			|| lattice_y < 0 || lattice_y >= lattice->getNumY())
+		return tracks;
+
+	std::set<Track*>& cell_tracks = _lattice_cell_tracks[lattice_id]
+						[lattice_y * lattice->getNumX() + lattice_x];
+	tracks.assign(cell_tracks.begin(), cell_tracks.end());
+
+	return tracks;
+}
+
+
+/**
+ * Fills a lattice cell with a different universe, e.g. to shuffle the
+ * assemblies of a core loading pattern. The new universe must have as many
+ * FSRs as the one it replaces so that the FSR ids outside of the lattice
+ * cell are unchanged. The segments of the tracks which cross the lattice
+ * cell must then be regenerated, which Solver::swapLatticeUniverse does
+ * @param lattice_id the lattice id
+ * @param lattice_x the x index of the lattice cell
+ * @param lattice_y the y index of the lattice cell
+ * @param universe_id the id of the universe to fill the lattice cell with
+ * @return whether or not the universe was swapped
+ */
+bool Geometry::swapLatticeUniverse(int lattice_id, int lattice_x,
+										int lattice_y, int universe_id) {
+
+	Lattice* lattice;
+	Universe* universe;
+	Universe* old_universe;
+
+	if (!mapContainsKey(_lattices, lattice_id) ||
+							!mapContainsKey(_universes, universe_id)) {
+		log_printf(WARNING, "Unable to swap universe id = %d into lattice "
+				"id = %d since one of them does not exist", universe_id,
+				lattice_id);
+		return false;
+	}
+
+	lattice = _lattices.at(lattice_id);
+	universe = _universes.at(universe_id);
+
+	if (lattice_x < 0 || lattice_x >= lattice->getNumX() || lattice_y < 0
+									|| lattice_y >= lattice->getNumY()) {
+		log_printf(WARNING, "Unable to swap a universe into lattice id = %d "
+				"at x = %d, y = %d which is out of bounds", lattice_id,
+				lattice_x, lattice_y);
+		return false;
+	}
+
+	old_universe = lattice->getUniverse(lattice_x, lattice_y);
+
+	if (universe->computeFSRMaps() != old_universe->computeFSRMaps()) {
+		log_printf(WARNING, "Unable to swap universe id = %d with %d FSRs "
+				"for universe id = %d with %d FSRs in lattice id = %d",
+				universe_id, universe->computeFSRMaps(),
+				old_universe->getId(), old_universe->computeFSRMaps(),
+				lattice_id);
+		return false;
+	}
+
+	lattice->setUniverse(lattice_x, lattice_y, universe);
+	_universes.at(0)->computeFSRMaps();
+
+	/* Reload the maps with cell and material ids */
+	for (int r=0; r < _num_FSRs; r++) {
+		CellBasic* curr =  static_cast<CellBasic*>
+						(findCell(_universes.at(0), r));
+		_FSRs_to_cells[r] = curr->getId();
+		_FSRs_to_materials[r] = curr->getMaterial();
+	}
+
+	log_printf(INFO, "Swapped universe id = %d for universe id = %d in "
+			"lattice id = %d at x = %d, y = %d", universe_id,
+			old_universe->getId(), lattice_id, lattice_x, lattice_y);
+
+	return true;
+}
+
+
 /**
  * Find and return the id of the flat source region that this localcoords
  * object is inside of
@@ -1826,6 +2013,51 @@ int Geometry::findFSRId(LocalCoords* coords) {
 }
 
 
+/**
+ * Renumbers the FSRs in the order the solver stores them. Segments made
+ * from now on hold the new ids, while findFSRId, findCell and the FSR
+ * maps keep the original ids, which are also used for the output
+ * @param external_ids the original id of each FSR in the new order
+ */
+void Geometry::renumberFSRs(std::vector<int>& external_ids) {
+
+	if ((int)external_ids.size() != _num_FSRs)
+		log_printf(ERROR, "Unable to renumber %d FSRs with %d new ids",
+									_num_FSRs, (int)external_ids.size());
+
+	_external_FSR_ids = external_ids;
+	_internal_FSR_ids.assign(_num_FSRs, -1);
+
+	for (int r = 0; r < _num_FSRs; r++)
+		_internal_FSR_ids[_external_FSR_ids[r]] = r;
+}
+
+
+/**
+ * Returns the id the solver stores an FSR under
+ * @param fsr_id the FSR's original id
+ * @return the FSR's new id, which is the original one if the FSRs have
+ *         not been renumbered
+ */
+int Geometry::getInternalFSRId(int fsr_id) const {
+	if (_internal_FSR_ids.empty())
+		return fsr_id;
+	return _internal_FSR_ids[fsr_id];
+}
+
+
+/**
+ * Returns the original id of an FSR
+ * @param fsr_id the id the solver stores the FSR under
+ * @return the FSR's original id
+ */
+int Geometry::getExternalFSRId(int fsr_id) const {
+	if (_external_FSR_ids.empty())
+		return fsr_id;
+	return _external_FSR_ids[fsr_id];
+}
+
+
 /**
  * This function calls the compress cross-sections method for each
  * Material in the Geometry. These methods will find the minimum
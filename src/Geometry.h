@@ -18,6 +18,7 @@
 #include <math.h>
 #include <limits.h>
 #include <vector>
+#include <set>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include "Parser.h"
@@ -35,6 +36,7 @@
 #include "Mesh.h"
 #include "MeshCell.h"
 #include "MeshSurface.h"
+#include "Arena.h"
 
 
 class Geometry {
@@ -54,6 +56,19 @@ private:
 
 	Mesh* _mesh;
 
+	/* Tracks which cross each lattice cell, indexed by lattice id and then
+	 * by lattice_y * num_x + lattice_x */
+	std::map<int, std::vector< std::set<Track*> > > _lattice_cell_tracks;
+	void indexLatticeCells(LocalCoords* coords, Track* track);
+
+	/* Id the solver stores each FSR under, and the original id of each
+	 * of these, or empty if the FSRs have not been renumbered */
+	std::vector<int> _internal_FSR_ids;
+	std::vector<int> _external_FSR_ids;
+
+	/* Holds the segments made by segmentize until it is released */
+	Arena* _segment_arena;
+
 
 public:
 	Geometry(Parser* parser);
@@ -71,6 +86,8 @@ public:
 
 	void addMaterial(Material* material);
 	Material* getMaterial(int id);
+	bool hasMaterial(int id);
+	Material* updateMaterial(Material* material);
 	void addSurface(Surface* surface);
 	Surface* getSurface(int id);
 	void addCell(Cell *cell);
@@ -90,7 +107,15 @@ public:
 	Cell* findCell(Universe* univ, int fsr_id);
 	Cell* findNextCell(LocalCoords* coords, double angle);
 	int findFSRId(LocalCoords* coords);
+	void renumberFSRs(std::vector<int>& external_ids);
+	int getInternalFSRId(int fsr_id) const;
+	int getExternalFSRId(int fsr_id) const;
 	void segmentize(Track* track);
+	Arena* getSegmentArena() const;
+	std::vector<Track*> getLatticeCellTracks(int lattice_id, int lattice_x,
+												int lattice_y);
+	bool swapLatticeUniverse(int lattice_id, int lattice_x, int lattice_y,
+												int universe_id);
 
 	void compressCrossSections();
 	void computePinPowers(double* FSRs_to_powers, double* FSRs_to_pin_powers);
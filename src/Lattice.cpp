@@ -164,6 +164,27 @@ Universe* Lattice::getUniverse(int lattice_x, int lattice_y) const {
 }
 
 
+/**
+ * Fills a lattice cell with a different universe
+ * @param lattice_x the x index of the lattice cell
+ * @param lattice_y the y index of the lattice cell
+ * @param universe pointer to the universe to fill the lattice cell with
+ */
+void Lattice::setUniverse(int lattice_x, int lattice_y, Universe* universe) {
+
+	/* Checks that lattice indices are within the bounds of the lattice */
+	if (lattice_x < 0 || lattice_x >= _num_x || lattice_y < 0 ||
+												lattice_y >= _num_y)
+		log_printf(ERROR, "Cannot set universe in lattice id = %d: "
+				"Index out of bounds: Tried to access cell x = %d, y = %d "
+				"but bounds are x = %d, y = %d", _id, lattice_x, lattice_y,
+				_num_x, _num_y);
+
+	_universes.at(lattice_y).at(lattice_x) =
+				std::pair<int, Universe*>(universe->getId(), universe);
+}
+
+
 /**
  * Return the width of the lattice along the x-axis
  * @return the width of the lattice
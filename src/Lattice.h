@@ -42,6 +42,7 @@ public:
 	std::vector< std::vector< std::pair<int, Universe*>>> 
 		getUniverses() const;
 	Universe* getUniverse(int lattice_x, int lattice_y) const;
+	void setUniverse(int lattice_x, int lattice_y, Universe* universe);
 	double getWidthX() const;
 	double getWidthY() const;
 	int getFSR(int lat_x, int lat_y);
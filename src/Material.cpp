@@ -311,6 +311,38 @@ int Material::getSigmaSEnd(int group) {
 }
 
 
+/**
+ * Return the nonzero scattering cross-sections in compressed sparse row
+ * format. The values for row (destination group) G start at index
+ * getSigmaSRowOffsets()[G]
+ * @return the nonzero scattering cross-sections
+ */
+double* Material::getSigmaSValues() {
+	return _sigma_s_values;
+}
+
+
+/**
+ * Return the source energy group of each nonzero scattering cross-section
+ * returned by getSigmaSValues
+ * @return the column index of each nonzero scattering cross-section
+ */
+int* Material::getSigmaSColumns() {
+	return _sigma_s_columns;
+}
+
+
+/**
+ * Return the index of the first nonzero scattering cross-section of each
+ * row in the compressed sparse row arrays. The array has one entry more
+ * than the number of energy groups so that row G ends at entry G+1
+ * @return the row offsets into the compressed sparse row arrays
+ */
+int* Material::getSigmaSRowOffsets() {
+	return _sigma_s_row_offsets;
+}
+
+
 /**
  * Set the material's chi array
  * @param chi the chi array
@@ -354,6 +386,8 @@ void Material::setSigmaS(double sigma_s[NUM_ENERGY_GROUPS][NUM_ENERGY_GROUPS]) {
 			for (int j=0; j < NUM_ENERGY_GROUPS; j++)
 			_sigma_s[i][j] = sigma_s[j][i];
 	}
+
+	computeSparseSigmaS();
 }
 
 
@@ -564,6 +598,69 @@ void Material::compressCrossSections() {
 //								i, _sigma_s_start[i], _sigma_s_end[i]);
 	}
 
+	computeSparseSigmaS();
+
+	return;
+}
+
+
+/**
+ * Replaces this material's cross-sections and fission spectrum with those
+ * of another material, e.g. one parsed from a perturbed material file, and
+ * recomputes the compressed indices
+ * @param material the material to copy the cross-sections from
+ * @return whether or not any of the cross-sections changed
+ */
+bool Material::setCrossSections(Material* material) {
+
+	bool changed =
+		memcmp(_sigma_t, material->_sigma_t, sizeof(_sigma_t)) != 0 ||
+		memcmp(_sigma_a, material->_sigma_a, sizeof(_sigma_a)) != 0 ||
+		memcmp(_sigma_f, material->_sigma_f, sizeof(_sigma_f)) != 0 ||
+		memcmp(_nu_sigma_f, material->_nu_sigma_f,
+										sizeof(_nu_sigma_f)) != 0 ||
+		memcmp(_chi, material->_chi, sizeof(_chi)) != 0 ||
+		memcmp(_sigma_s, material->_sigma_s, sizeof(_sigma_s)) != 0;
+
+	if (!changed)
+		return false;
+
+	memcpy(_sigma_t, material->_sigma_t, sizeof(_sigma_t));
+	memcpy(_sigma_a, material->_sigma_a, sizeof(_sigma_a));
+	memcpy(_sigma_f, material->_sigma_f, sizeof(_sigma_f));
+	memcpy(_nu_sigma_f, material->_nu_sigma_f, sizeof(_nu_sigma_f));
+	memcpy(_chi, material->_chi, sizeof(_chi));
+	memcpy(_sigma_s, material->_sigma_s, sizeof(_sigma_s));
+
+	compressCrossSections();
+
+	return true;
+}
+
+
+/**
+ * Stores the nonzero elements of the scattering matrix in compressed sparse
+ * row format. Unlike the start and end indices per row this skips zeros
+ * inside each row, which matters for large group structures
+ */
+void Material::computeSparseSigmaS() {
+
+	int index = 0;
+
+	for (int i=0; i < NUM_ENERGY_GROUPS; i++) {
+		_sigma_s_row_offsets[i] = index;
+
+		for (int j=0; j < NUM_ENERGY_GROUPS; j++) {
+			if (_sigma_s[i][j] != 0) {
+				_sigma_s_values[index] = _sigma_s[i][j];
+				_sigma_s_columns[index] = j;
+				index++;
+			}
+		}
+	}
+
+	_sigma_s_row_offsets[NUM_ENERGY_GROUPS] = index;
+
 	return;
 }
 
@@ -37,6 +37,15 @@ private:
 	int _chi_start, _chi_end;
 	int _sigma_s_start[NUM_ENERGY_GROUPS];
 	int _sigma_s_end[NUM_ENERGY_GROUPS];
+
+	/* Nonzero elements of the (transposed) scattering matrix in compressed
+	 * sparse row format. Row G holds the elements from
+	 * _sigma_s_row_offsets[G] up to _sigma_s_row_offsets[G+1], each for
+	 * scattering from group _sigma_s_columns[i] into group G */
+	double _sigma_s_values[NUM_ENERGY_GROUPS*NUM_ENERGY_GROUPS];
+	int _sigma_s_columns[NUM_ENERGY_GROUPS*NUM_ENERGY_GROUPS];
+	int _sigma_s_row_offsets[NUM_ENERGY_GROUPS + 1];
+	void computeSparseSigmaS();
 public:
 	Material(int id,
 			 double *sigma_a, int sigma_a_cnt,
@@ -68,6 +77,9 @@ public:
 	int getChiEnd();
 	int getSigmaSStart(int group);
 	int getSigmaSEnd(int group);
+	double* getSigmaSValues();
+	int* getSigmaSColumns();
+	int* getSigmaSRowOffsets();
 
 	void setChi(double chi[NUM_ENERGY_GROUPS]);
 	void setSigmaF(double sigma_f[NUM_ENERGY_GROUPS]);
@@ -79,6 +91,7 @@ public:
 	void checkSigmaT();
 	std::string toString();
 	void compressCrossSections();
+	bool setCrossSections(Material* material);
 };
 
 #endif /* MATERIAL_H_ */
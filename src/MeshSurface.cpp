@@ -36,7 +36,13 @@ double MeshSurface::getCurrent(int group){
 }
 
 void MeshSurface::incrementCurrent(double current, double phi, int group){
-	_current[group] += current * fabs(cos(_normal - phi));
+	current *= fabs(cos(_normal - phi));
+
+	/* Segments on different threads may tally to the same surface */
+	#if USE_OPENMP
+	#pragma omp atomic
+	#endif
+	_current[group] += current;
 }
 
 void MeshSurface::setNormal(double normal){
@@ -56,5 +62,8 @@ double MeshSurface::getFlux(int group){
 }
 
 void MeshSurface::incrementFlux(double flux, int group){
+	#if USE_OPENMP
+	#pragma omp atomic
+	#endif
 	_flux[group] += flux;
 }
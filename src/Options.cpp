@@ -44,6 +44,36 @@ Options::Options(int argc, const char **argv) {
 	_compress_cross_sections = false;/* Default will not compress cross-sections */
 	_cmfd = true; /* Default will not perform CMFD acceleration */
 	_plot_current = false;			/* Default will not plot net current */
+	_arnoldi = false;				/* Default will use power iteration */
+	_second_eigenvalue = false;		/* Default will not compute k_2 */
+	_energy_gauss_seidel = false;	/* Default will sweep all groups at once */
+	_num_upscatter_iterations = 1;	/* Default upscatter sub-iterations */
+	_coarse_mesh_rebalance = false;	/* Default will not rebalance on the mesh */
+	_skip_converged_groups = false;	/* Default will sweep until all converge */
+	_keff_tolerance = KEFF_CONVERG_THRESH;	/* Default k_eff tolerance */
+	_source_tolerance = 0.0;		/* Default will not check fission source */
+	_source_norm_linf = false;		/* Default fission source residual is L2 */
+	_flux_tolerance = 0.0;			/* Default will not check scalar flux */
+	_checkpoint_file = "";			/* Default will not write checkpoints */
+	_checkpoint_interval = 0;		/* Default will only checkpoint at exit */
+	_restart_file = "";				/* Default will start from a flat flux */
+	_batch_summary_file = "batch_summary.txt";	/* Default batch results */
+	_batch_sweep = false;			/* Default will solve batch cases in turn */
+	_server = false;				/* Default will solve the material file */
+	_server_socket = "";			/* Default server reads jobs from stdin */
+	_segment_database = "";			/* Default tracks keep their segments */
+	_num_domains_x = 0;				/* Default subdomain grid is as square */
+	_num_domains_y = 0;				/* as the number of processes allows */
+	_tiles = false;					/* Default sweeps the whole tracks */
+	_num_tiles_x = 0;				/* Default tiles are sized to fit the */
+	_num_tiles_y = 0;				/* FSR data in the L2 cache */
+	_hardware_counters = false;		/* Default will not count cache misses */
+	_renumber_FSRs = false;			/* Default keeps the geometry's FSR ids */
+	_chains = false;				/* Default sweeps the tracks in order */
+	_pin_threads = false;			/* Default leaves the threads to the OS */
+	_scatter_threads = false;		/* Default fills one socket at a time */
+	_num_sockets = 0;				/* Default pins threads on all sockets */
+	_huge_pages = false;			/* Default arenas use normal pages */
 
 
 	for (int i = 0; i < argc; i++) {
@@ -58,6 +88,59 @@ Options::Options(int argc, const char **argv) {
 				_track_spacing = atof(argv[i]);
 			else if (LAST("--numazimuthal") || LAST("-na"))
 				_num_azim = atoi(argv[i]);
+			else if (LAST("--upscatteriterations") || LAST("-ui"))
+				_num_upscatter_iterations = atoi(argv[i]);
+			else if (LAST("--coarsegroups") || LAST("-cg")) {
+				char* bounds = strdup(argv[i]);
+				for (char* token = strtok(bounds, ","); token != NULL;
+										token = strtok(NULL, ","))
+					_coarse_group_bounds.push_back(atoi(token));
+				free(bounds);
+			}
+			else if (LAST("--kefftolerance") || LAST("-kt"))
+				_keff_tolerance = atof(argv[i]);
+			else if (LAST("--sourcetolerance") || LAST("-st"))
+				_source_tolerance = atof(argv[i]);
+			else if (LAST("--sourcenorm") || LAST("-sn"))
+				_source_norm_linf = (strcmp(argv[i], "Linf") == 0);
+			else if (LAST("--fluxtolerance") || LAST("-ft"))
+				_flux_tolerance = atof(argv[i]);
+			else if (LAST("--checkpointfile") || LAST("-cf"))
+				_checkpoint_file = argv[i];
+			else if (LAST("--checkpointinterval") || LAST("-ci"))
+				_checkpoint_interval = atoi(argv[i]);
+			else if (LAST("--restartfile") || LAST("-rf"))
+				_restart_file = argv[i];
+			else if (LAST("--batchmaterials") || LAST("-bm")) {
+				char* files = strdup(argv[i]);
+				for (char* token = strtok(files, ","); token != NULL;
+										token = strtok(NULL, ","))
+					_batch_material_files.push_back(token);
+				free(files);
+			}
+			else if (LAST("--batchsummary") || LAST("-bs"))
+				_batch_summary_file = argv[i];
+			else if (LAST("--serversocket") || LAST("-so")) {
+				_server = true;
+				_server_socket = argv[i];
+			}
+			else if (LAST("--segmentdatabase") || LAST("-sd"))
+				_segment_database = argv[i];
+			else if (LAST("--domains") || LAST("-dd"))
+				sscanf(argv[i], "%d,%d", &_num_domains_x, &_num_domains_y);
+			else if (LAST("--tiles") || LAST("-tl")) {
+				_tiles = true;
+				if (strcmp(argv[i], "auto") != 0)
+					sscanf(argv[i], "%d,%d", &_num_tiles_x, &_num_tiles_y);
+			}
+			else if (LAST("--affinity") || LAST("-af")) {
+				_pin_threads = true;
+				_scatter_threads = (strcmp(argv[i], "scatter") == 0);
+			}
+			else if (LAST("--sockets") || LAST("-sk")) {
+				_pin_threads = true;
+				_num_sockets = atoi(argv[i]);
+			}
 			else if (LAST("--bitdimension") || LAST("-bd"))
 							_bit_dimension = atoi(argv[i]);
 			else if (LAST("--verbosity") || LAST("-v"))
@@ -82,6 +165,41 @@ Options::Options(int argc, const char **argv) {
 			else if (strcmp(argv[i], "-pc") == 0 ||
 					strcmp(argv[i], "--plotcurrent") == 0)
 				_plot_current = true;
+			else if (strcmp(argv[i], "-ar") == 0 ||
+					strcmp(argv[i], "--arnoldi") == 0)
+				_arnoldi = true;
+			else if (strcmp(argv[i], "-k2") == 0 ||
+					strcmp(argv[i], "--secondeigenvalue") == 0) {
+				_arnoldi = true;
+				_second_eigenvalue = true;
+			}
+			else if (strcmp(argv[i], "-egs") == 0 ||
+					strcmp(argv[i], "--energygaussseidel") == 0)
+				_energy_gauss_seidel = true;
+			else if (strcmp(argv[i], "-cmr") == 0 ||
+					strcmp(argv[i], "--coarsemeshrebalance") == 0)
+				_coarse_mesh_rebalance = true;
+			else if (strcmp(argv[i], "-scg") == 0 ||
+					strcmp(argv[i], "--skipconvergedgroups") == 0)
+				_skip_converged_groups = true;
+			else if (strcmp(argv[i], "-bsw") == 0 ||
+					strcmp(argv[i], "--batchsweep") == 0)
+				_batch_sweep = true;
+			else if (strcmp(argv[i], "-sv") == 0 ||
+					strcmp(argv[i], "--server") == 0)
+				_server = true;
+			else if (strcmp(argv[i], "-hc") == 0 ||
+					strcmp(argv[i], "--hardwarecounters") == 0)
+				_hardware_counters = true;
+			else if (strcmp(argv[i], "-rn") == 0 ||
+					strcmp(argv[i], "--renumberfsrs") == 0)
+				_renumber_FSRs = true;
+			else if (strcmp(argv[i], "-ch") == 0 ||
+					strcmp(argv[i], "--chains") == 0)
+				_chains = true;
+			else if (strcmp(argv[i], "-hp") == 0 ||
+					strcmp(argv[i], "--hugepages") == 0)
+				_huge_pages = true;
 		}
 	}
 }
@@ -226,3 +344,310 @@ bool Options::plotCurrent() const {
 	return _plot_current;
 }
 
+
+/**
+ * Returns a boolean representing whether or not to compute k_eff with the
+ * Arnoldi eigenvalue solver instead of power iteration
+ * @return whether or not to use the Arnoldi solver
+ */
+bool Options::arnoldi() const {
+	return _arnoldi;
+}
+
+/**
+ * Returns a boolean representing whether or not to compute the second
+ * eigenvalue and the dominance ratio. This implies the Arnoldi solver
+ * @return whether or not to compute the second eigenvalue
+ */
+bool Options::secondEigenvalue() const {
+	return _second_eigenvalue;
+}
+
+/**
+ * Returns a boolean representing whether or not to use Gauss-Seidel
+ * iteration in energy when computing k_eff
+ * @return whether or not to use Gauss-Seidel iteration in energy
+ */
+bool Options::energyGaussSeidel() const {
+	return _energy_gauss_seidel;
+}
+
+/**
+ * Returns the number of sub-iterations over the upscatter block of energy
+ * groups for Gauss-Seidel iteration in energy. By default this will return
+ * 1 if not set at runtime from the console
+ * @return the number of upscatter sub-iterations
+ */
+int Options::getNumUpscatterIterations() const {
+	return _num_upscatter_iterations;
+}
+
+/**
+ * Returns the first fine energy group of each coarse group for the coarse
+ * energy rebalance, given at runtime as a comma separated list (e.g. 0,3).
+ * By default this will return an empty list, which turns off the rebalance
+ * @return the first fine energy group of each coarse group
+ */
+std::vector<int> Options::getCoarseGroupBounds() const {
+	return _coarse_group_bounds;
+}
+
+/**
+ * Returns a boolean representing whether or not to rebalance the fluxes
+ * on the CMFD mesh after each source iteration
+ * @return whether or not to use coarse mesh rebalance
+ */
+bool Options::coarseMeshRebalance() const {
+	return _coarse_mesh_rebalance;
+}
+
+/**
+ * Returns a boolean representing whether or not to drop energy groups
+ * whose scalar flux has converged from the remaining fixed source sweeps
+ * @return whether or not to skip converged energy groups
+ */
+bool Options::skipConvergedGroups() const {
+	return _skip_converged_groups;
+}
+
+/**
+ * Returns the tolerance on the change in k_eff between source iterations.
+ * By default this will return KEFF_CONVERG_THRESH if not set at runtime
+ * from the console
+ * @return the k_eff tolerance
+ */
+double Options::getKeffTolerance() const {
+	return _keff_tolerance;
+}
+
+/**
+ * Returns the tolerance on the relative change in the fission source
+ * distribution between source iterations. By default this will return 0,
+ * which turns off this stopping criterion
+ * @return the fission source tolerance
+ */
+double Options::getSourceTolerance() const {
+	return _source_tolerance;
+}
+
+/**
+ * Returns a boolean representing whether the fission source residual is
+ * the L-infinity norm (given at runtime as Linf) rather than the L2 norm
+ * @return whether or not to use the L-infinity norm
+ */
+bool Options::sourceNormLinf() const {
+	return _source_norm_linf;
+}
+
+/**
+ * Returns the tolerance on the largest relative change in the scalar flux
+ * in each source iteration. By default this will return 0, which turns off
+ * this stopping criterion
+ * @return the scalar flux tolerance
+ */
+double Options::getFluxTolerance() const {
+	return _flux_tolerance;
+}
+
+/**
+ * Returns the path of the binary checkpoint file for the solver state. By
+ * default this will return an empty string, which turns off checkpoints
+ * @return the checkpoint file path
+ */
+std::string Options::getCheckpointFile() const {
+	return _checkpoint_file;
+}
+
+/**
+ * Returns the number of source iterations between checkpoints. By default
+ * this will return 0, which only writes a checkpoint at exit
+ * @return the checkpoint interval
+ */
+int Options::getCheckpointInterval() const {
+	return _checkpoint_interval;
+}
+
+/**
+ * Returns the path of a checkpoint file to restart the solver from. By
+ * default this will return an empty string, which starts from a flat flux
+ * @return the restart file path
+ */
+std::string Options::getRestartFile() const {
+	return _restart_file;
+}
+
+/**
+ * Returns the material files to solve in batch mode after the material
+ * file, given at runtime as a comma separated list. By default this will
+ * return an empty list, which turns off batch mode
+ * @return the batch material file paths
+ */
+std::vector<std::string> Options::getBatchMaterialFiles() const {
+	return _batch_material_files;
+}
+
+/**
+ * Returns the path of the file which summarizes the results of each case
+ * in batch mode. By default this will return batch_summary.txt
+ * @return the batch summary file path
+ */
+std::string Options::getBatchSummaryFile() const {
+	return _batch_summary_file;
+}
+
+/**
+ * Returns a boolean representing whether or not to solve all of the batch
+ * material files together with a single sweep of the segments for all of
+ * them in each source iteration. By default this will return false
+ * @return whether or not to sweep the batch cases together
+ */
+bool Options::batchSweep() const {
+	return _batch_sweep;
+}
+
+/**
+ * Returns a boolean representing whether or not to run as a server which
+ * keeps the geometry, tracks and segments and solves a job for each
+ * request it reads. By default this will return false
+ * @return whether or not to run as a server
+ */
+bool Options::server() const {
+	return _server;
+}
+
+/**
+ * Returns the path of the Unix domain socket on which the server accepts
+ * jobs. By default this will return an empty string and the server reads
+ * jobs from stdin
+ * @return the server socket path
+ */
+std::string Options::getServerSocket() const {
+	return _server_socket;
+}
+
+/**
+ * Returns the path of the segment database file which is shared read-only
+ * with other processes solving the same geometry. By default this will
+ * return an empty string and each process keeps its own segments
+ * @return the segment database path
+ */
+std::string Options::getSegmentDatabase() const {
+	return _segment_database;
+}
+
+/**
+ * Returns the number of subdomains along x into which the geometry is
+ * decomposed for MPI. By default this will return 0 and the subdomain
+ * grid is chosen from the number of processes
+ * @return the number of subdomains along x
+ */
+int Options::getNumDomainsX() const {
+	return _num_domains_x;
+}
+
+/**
+ * Returns the number of subdomains along y into which the geometry is
+ * decomposed for MPI. By default this will return 0 and the subdomain
+ * grid is chosen from the number of processes
+ * @return the number of subdomains along y
+ */
+int Options::getNumDomainsY() const {
+	return _num_domains_y;
+}
+
+/**
+ * Returns a boolean representing whether or not to cut the tracks into
+ * tiles which are swept one at a time. By default this will return false
+ * @return whether or not to tile the tracks
+ */
+bool Options::tiles() const {
+	return _tiles;
+}
+
+/**
+ * Returns the number of tiles along x into which the tracks are cut. By
+ * default this will return 0 and the tiles are sized to fit the FSR data
+ * inside each one in the L2 cache
+ * @return the number of tiles along x
+ */
+int Options::getNumTilesX() const {
+	return _num_tiles_x;
+}
+
+/**
+ * Returns the number of tiles along y into which the tracks are cut. By
+ * default this will return 0 and the tiles are sized to fit the FSR data
+ * inside each one in the L2 cache
+ * @return the number of tiles along y
+ */
+int Options::getNumTilesY() const {
+	return _num_tiles_y;
+}
+
+/**
+ * Returns a boolean representing whether or not to count the cache loads
+ * and misses of the fixed source iteration with the hardware performance
+ * counters. By default this will return false
+ * @return whether or not to count cache misses
+ */
+bool Options::hardwareCounters() const {
+	return _hardware_counters;
+}
+
+/**
+ * Returns a boolean representing whether or not to renumber the FSRs in
+ * the order the transport sweep reaches them. By default this will return
+ * false and the FSRs keep the ids of the geometry
+ * @return whether or not to renumber the FSRs
+ */
+bool Options::renumberFSRs() const {
+	return _renumber_FSRs;
+}
+
+/**
+ * Returns a boolean representing whether or not to sweep the tracks along
+ * the chains in which they pass their angular fluxes to each other. By
+ * default this will return false and the tracks are swept in order
+ * @return whether or not to sweep the tracks in chains
+ */
+bool Options::chains() const {
+	return _chains;
+}
+
+/**
+ * Returns a boolean representing whether or not to pin the threads to the
+ * CPUs and allocate the segments in the threads which sweep them. By
+ * default this will return false and the OS places the threads
+ * @return whether or not to pin the threads
+ */
+bool Options::pinThreads() const {
+	return _pin_threads;
+}
+
+/**
+ * Returns a boolean representing whether or not consecutive threads are
+ * pinned to different sockets in turn. By default this will return false
+ * and the threads fill the CPUs of one socket before the next
+ * @return whether or not to scatter the threads over the sockets
+ */
+bool Options::scatterThreads() const {
+	return _scatter_threads;
+}
+
+/**
+ * Returns the number of sockets to pin the threads to. By default this
+ * will return 0 and all sockets are used
+ * @return the number of sockets
+ */
+int Options::getNumSockets() const {
+	return _num_sockets;
+}
+
+/**
+ * Returns a boolean representing whether or not to back the arenas which
+ * hold the segments with huge pages. By default this will return false
+ * @return whether or not to use huge pages
+ */
+bool Options::hugePages() const {
+	return _huge_pages;
+}
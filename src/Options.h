@@ -15,7 +15,9 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <vector>
 #include "log.h"
+#include "configurations.h"
 
 class Options {
 private:
@@ -37,6 +39,38 @@ private:
 	bool _compress_cross_sections;
 	bool _cmfd;
 	bool _plot_current;
+	bool _arnoldi;
+	bool _second_eigenvalue;
+	bool _energy_gauss_seidel;
+	int _num_upscatter_iterations;
+	std::vector<int> _coarse_group_bounds;
+	bool _coarse_mesh_rebalance;
+	bool _skip_converged_groups;
+	double _keff_tolerance;
+	double _source_tolerance;
+	bool _source_norm_linf;
+	double _flux_tolerance;
+	std::string _checkpoint_file;
+	int _checkpoint_interval;
+	std::string _restart_file;
+	std::vector<std::string> _batch_material_files;
+	std::string _batch_summary_file;
+	bool _batch_sweep;
+	bool _server;
+	std::string _server_socket;
+	std::string _segment_database;
+	int _num_domains_x;
+	int _num_domains_y;
+	bool _tiles;
+	int _num_tiles_x;
+	int _num_tiles_y;
+	bool _hardware_counters;
+	bool _renumber_FSRs;
+	bool _chains;
+	bool _pin_threads;
+	bool _scatter_threads;
+	int _num_sockets;
+	bool _huge_pages;
 public:
     Options(int argc, const char **argv);
     ~Options(void);
@@ -54,6 +88,38 @@ public:
     bool compressCrossSections() const;
 	bool cmfd() const;
 	bool plotCurrent() const;
+	bool arnoldi() const;
+	bool secondEigenvalue() const;
+	bool energyGaussSeidel() const;
+	int getNumUpscatterIterations() const;
+	std::vector<int> getCoarseGroupBounds() const;
+	bool coarseMeshRebalance() const;
+	bool skipConvergedGroups() const;
+	double getKeffTolerance() const;
+	double getSourceTolerance() const;
+	bool sourceNormLinf() const;
+	double getFluxTolerance() const;
+	std::string getCheckpointFile() const;
+	int getCheckpointInterval() const;
+	std::string getRestartFile() const;
+	std::vector<std::string> getBatchMaterialFiles() const;
+	std::string getBatchSummaryFile() const;
+	bool batchSweep() const;
+	bool server() const;
+	std::string getServerSocket() const;
+	std::string getSegmentDatabase() const;
+	int getNumDomainsX() const;
+	int getNumDomainsY() const;
+	bool tiles() const;
+	int getNumTilesX() const;
+	int getNumTilesY() const;
+	bool hardwareCounters() const;
+	bool renumberFSRs() const;
+	bool chains() const;
+	bool pinThreads() const;
+	bool scatterThreads() const;
+	int getNumSockets() const;
+	bool hugePages() const;
 };
 
 #endif
@@ -238,7 +238,6 @@ static inline char *astrncat(char *orig, char *next, int len);
  */
 Parser::Parser (const Options *opts) {
 	FILE* geofile;
-	FILE* matfile;
 	XML_Parser parser;
 	struct stack stack;
 	char c;
@@ -272,6 +271,22 @@ Parser::Parser (const Options *opts) {
 	XML_Parse(parser, NULL, 0, true);
 	XML_ParserFree(parser);
 
+	parseMaterials(opts->getMaterialFile());
+}
+
+/**
+ * Parses a material file, replacing any materials parsed before. This
+ * allows several material files to be read for the same geometry
+ * @param material_file the path to the material input file
+ */
+void Parser::parseMaterials(const char* material_file) {
+	FILE* matfile;
+	XML_Parser parser;
+	struct stack stack;
+	char c;
+
+	materials.clear();
+
 	/* Sets up the parser */
 	stack.top = NULL;
 	stack.parser = this;
@@ -282,10 +297,10 @@ Parser::Parser (const Options *opts) {
 	XML_SetCharacterDataHandler(parser, &Parser_XMLCallback_CData);
 
 	/* Assures that the input file(s) exists and is readable */
-	matfile = fopen(opts->getMaterialFile(), "r");
+	matfile = fopen(material_file, "r");
 	if (matfile == NULL) {
 		log_printf(ERROR, "Given material file %s does not exist",
-			   opts->getMaterialFile());
+			   material_file);
 	}
 
 	/* Passes single characters to the parser, which is quite slow but
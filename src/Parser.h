@@ -40,6 +40,8 @@ public:
 	Parser(const Options *opts);
 	virtual ~Parser();
 
+	void parseMaterials(const char* material_file);
+
 	void each_surface(std::function<void(Surface *)> callback);
 	void each_cell(std::function<void(Cell *)> callback);
 	void each_lattice(std::function<void(Lattice *)> callback);
@@ -0,0 +1,164 @@
+/*
+ * PerfCounters.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *
+ *  Counts the last level cache loads and misses of the process with the
+ *  Linux hardware performance counters, in splits like the Timer
+ *
+ */
+
+#include "PerfCounters.h"
+
+
+/**
+ * PerfCounters constructor opens the counters. They count the user space
+ * loads of this process and of the threads it starts afterwards, so they
+ * must be created before the first OpenMP parallel region. There is no
+ * generic L2 event, so the misses of the private caches are counted as the
+ * loads which reach the last level cache
+ */
+PerfCounters::PerfCounters() {
+
+	_running = false;
+	_start_loads = 0;
+	_start_misses = 0;
+	_loads = 0;
+	_misses = 0;
+
+#ifdef __linux__
+	_loads_fd = openCounter(PERF_COUNT_HW_CACHE_LL |
+						(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+						(PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16));
+	_misses_fd = openCounter(PERF_COUNT_HW_CACHE_LL |
+						(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+						(PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#else
+	_loads_fd = -1;
+	_misses_fd = -1;
+#endif
+
+	if (!isAvailable())
+		log_printf(WARNING, "Unable to open the hardware cache counters, "
+							"no cache misses will be reported");
+}
+
+
+/**
+ * PerfCounters destructor closes the counters
+ */
+PerfCounters::~PerfCounters() {
+	if (_loads_fd >= 0)
+		close(_loads_fd);
+	if (_misses_fd >= 0)
+		close(_misses_fd);
+}
+
+
+/**
+ * Opens one hardware cache counter for this process and its new threads
+ * @param config the cache, operation and result to count
+ * @return the counter's file descriptor, or -1 if it could not be opened
+ */
+int PerfCounters::openCounter(unsigned long long config) {
+
+#ifdef __linux__
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HW_CACHE;
+	attr.config = config;
+	attr.inherit = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+	return -1;
+#endif
+}
+
+
+/**
+ * Reads a counter, including the counts of the threads which inherited it
+ * @param fd the counter's file descriptor
+ * @return the number of events counted since it was opened
+ */
+long long PerfCounters::readCounter(int fd) {
+	long long count = 0;
+	if (read(fd, &count, sizeof(count)) != sizeof(count))
+		return 0;
+	return count;
+}
+
+
+/**
+ * Returns whether or not the hardware counters could be opened
+ * @return whether or not the counters are available
+ */
+bool PerfCounters::isAvailable() const {
+	return _loads_fd >= 0 && _misses_fd >= 0;
+}
+
+
+/**
+ * Starts counting - similar to starting the Timer
+ */
+void PerfCounters::start() {
+	if (!_running && isAvailable()) {
+		_start_loads = readCounter(_loads_fd);
+		_start_misses = readCounter(_misses_fd);
+		_running = true;
+	}
+}
+
+
+/**
+ * Stops counting and adds the loads and misses since the last start
+ */
+void PerfCounters::stop() {
+	if (_running) {
+		_loads += readCounter(_loads_fd) - _start_loads;
+		_misses += readCounter(_misses_fd) - _start_misses;
+		_running = false;
+	}
+}
+
+
+/**
+ * Resets the counted loads and misses to zero
+ */
+void PerfCounters::reset() {
+	_loads = 0;
+	_misses = 0;
+	_running = false;
+}
+
+
+/**
+ * Records a message with the loads and misses counted so far. This assumes
+ * that counting has been stopped
+ * @param msg a message corresponding to this split
+ */
+void PerfCounters::recordSplit(const char* msg) {
+	perf_split split;
+	split._msg = msg;
+	split._loads = _loads;
+	split._misses = _misses;
+	_splits.push_back(split);
+}
+
+
+/**
+ * Prints the message, last level cache loads and misses of each split
+ */
+void PerfCounters::printSplits() {
+
+	if (!isAvailable())
+		return;
+
+	for (unsigned int i = 0; i < _splits.size(); i++) {
+		log_printf(RESULT, "%s: %lld L2 misses (LLC loads), %lld LLC misses",
+					_splits[i]._msg, _splits[i]._loads, _splits[i]._misses);
+	}
+}
@@ -0,0 +1,54 @@
+/*
+ * PerfCounters.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ *  Counts the last level cache loads and misses of the process with the
+ *  Linux hardware performance counters, in splits like the Timer
+ *
+ */
+
+#ifndef PERFCOUNTERS_H_
+#define PERFCOUNTERS_H_
+
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include "log.h"
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/* Cache loads and misses counted between a start and stop */
+struct perf_split {
+	const char* _msg;
+	long long _loads;
+	long long _misses;
+};
+
+class PerfCounters {
+private:
+	int _loads_fd;
+	int _misses_fd;
+	bool _running;
+	long long _start_loads;
+	long long _start_misses;
+	long long _loads;
+	long long _misses;
+	std::vector<perf_split> _splits;
+	int openCounter(unsigned long long config);
+	long long readCounter(int fd);
+public:
+	PerfCounters();
+	virtual ~PerfCounters();
+	bool isAvailable() const;
+	void start();
+	void stop();
+	void reset();
+	void recordSplit(const char* msg);
+	void printSplits();
+};
+
+#endif /* PERFCOUNTERS_H_ */
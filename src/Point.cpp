@@ -16,6 +16,16 @@
 Point::Point() { }
 
 
+/**
+ * Copy constructor
+ * @param point the point to copy
+ */
+Point::Point(const Point& point) {
+	_x = point._x;
+	_y = point._y;
+}
+
+
 /**
  * Destructor
  */
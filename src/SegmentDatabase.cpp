@@ -0,0 +1,295 @@
+/*
+ * SegmentDatabase.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *
+ *  File-backed store of the segments of all tracks which is mapped
+ *  read-only so that processes solving the same geometry share one copy
+ *
+ */
+
+#include "SegmentDatabase.h"
+
+/* Identifies and versions the segment database file format */
+static const char DATABASE_ID[8] = {'O', 'M', 'O', 'C', 'S', 'E', 'G', '1'};
+
+/* Header at the start of the database file. It is followed by the number
+ * of tracks at each azimuthal angle, padded to eight bytes, the offset of
+ * the first segment of each track and the segments themselves */
+struct database_header {
+	char _id[8];
+	int32_t _num_azim;
+	int32_t _num_FSRs;
+	int32_t _num_tracks;
+	int32_t _padding;
+	double _spacing;
+	int64_t _num_segments;
+};
+
+
+/**
+ * Returns the size in bytes of the track counts, padded so that the
+ * offsets which follow them are aligned
+ * @param num_azim the number of azimuthal angles
+ * @return the padded size of the track counts
+ */
+static size_t trackCountsSize(int num_azim) {
+	return (num_azim * sizeof(int32_t) + 7) / 8 * 8;
+}
+
+
+/**
+ * SegmentDatabase constructor
+ */
+SegmentDatabase::SegmentDatabase() {
+	_map = NULL;
+	_map_size = 0;
+	_num_azim = 0;
+	_num_FSRs = 0;
+	_track_offsets = NULL;
+	_segments = NULL;
+}
+
+
+/**
+ * SegmentDatabase destructor unmaps the database file
+ */
+SegmentDatabase::~SegmentDatabase() {
+	if (_map != NULL)
+		munmap(_map, _map_size);
+}
+
+
+/**
+ * Writes the segments of all tracks to a database file. The file is
+ * written under a temporary name and then renamed so that processes
+ * mapping it concurrently never see a partial database
+ * @param path the path of the database file
+ * @param tracks the tracks for each azimuthal angle
+ * @param num_tracks the number of tracks for each azimuthal angle
+ * @param num_azim the number of azimuthal angles
+ * @param spacing the track spacing
+ * @param num_FSRs the number of flat source regions
+ * @return whether or not the database could be written
+ */
+bool SegmentDatabase::write(const char* path, Track** tracks, int* num_tracks,
+							int num_azim, double spacing, int num_FSRs) {
+
+	database_header header;
+	memcpy(header._id, DATABASE_ID, sizeof(DATABASE_ID));
+	header._num_azim = num_azim;
+	header._num_FSRs = num_FSRs;
+	header._num_tracks = 0;
+	header._padding = 0;
+	header._spacing = spacing;
+	header._num_segments = 0;
+
+	std::vector<int32_t> track_counts(trackCountsSize(num_azim) /
+												sizeof(int32_t), 0);
+	std::vector<int64_t> track_offsets;
+
+	for (int i = 0; i < num_azim; i++) {
+		track_counts[i] = num_tracks[i];
+		header._num_tracks += num_tracks[i];
+
+		for (int j = 0; j < num_tracks[i]; j++) {
+			track_offsets.push_back(header._num_segments);
+			header._num_segments += tracks[i][j].getNumSegments();
+		}
+	}
+
+	track_offsets.push_back(header._num_segments);
+
+	char temp_path[FILENAME_MAX];
+	snprintf(temp_path, FILENAME_MAX, "%s.%d", path, (int)getpid());
+
+	FILE* file = fopen(temp_path, "wb");
+	if (file == NULL) {
+		log_printf(WARNING, "Unable to open segment database file %s",
+															temp_path);
+		return false;
+	}
+
+	bool written = true;
+	written &= fwrite(&header, sizeof(header), 1, file) == 1;
+	written &= fwrite(&track_counts[0], sizeof(int32_t),
+				track_counts.size(), file) == track_counts.size();
+	written &= fwrite(&track_offsets[0], sizeof(int64_t),
+				track_offsets.size(), file) == track_offsets.size();
+
+	shared_segment record;
+	segment* seg;
+
+	for (int i = 0; i < num_azim && written; i++) {
+		for (int j = 0; j < num_tracks[i]; j++) {
+			for (int s = 0; s < tracks[i][j].getNumSegments(); s++) {
+				seg = tracks[i][j].getSegment(s);
+				record._length = seg->_length;
+				record._region_id = seg->_region_id;
+				record._material_id = seg->_material->getId();
+				written &= fwrite(&record, sizeof(record), 1, file) == 1;
+			}
+		}
+	}
+
+	written &= fclose(file) == 0;
+
+	if (!written || rename(temp_path, path) != 0) {
+		log_printf(WARNING, "Unable to write segment database file %s", path);
+		remove(temp_path);
+		return false;
+	}
+
+	log_printf(NORMAL, "Wrote %ld segments to segment database %s",
+						(long)header._num_segments, path);
+
+	return true;
+}
+
+
+/**
+ * Maps a database file read-only and checks that it holds the segments of
+ * the same tracks as this run
+ * @param path the path of the database file
+ * @param num_tracks the number of tracks for each azimuthal angle
+ * @param num_azim the number of azimuthal angles
+ * @param spacing the track spacing
+ * @param num_FSRs the number of flat source regions
+ * @return whether or not the database could be mapped
+ */
+bool SegmentDatabase::map(const char* path, int* num_tracks, int num_azim,
+											double spacing, int num_FSRs) {
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 ||
+				(size_t)file_stat.st_size < sizeof(database_header)) {
+		log_printf(WARNING, "Segment database %s is truncated", path);
+		close(fd);
+		return false;
+	}
+
+	size_t map_size = file_stat.st_size;
+	void* map = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED) {
+		log_printf(WARNING, "Unable to map segment database %s", path);
+		return false;
+	}
+
+	const char* data = (const char*)map;
+	const database_header* header = (const database_header*)data;
+	const int32_t* track_counts = (const int32_t*)(data + sizeof(*header));
+	bool matches = memcmp(header->_id, DATABASE_ID,
+							sizeof(DATABASE_ID)) == 0 &&
+					header->_num_azim == num_azim &&
+					header->_num_FSRs == num_FSRs &&
+					header->_spacing == spacing;
+
+	size_t offsets_start = sizeof(*header) + trackCountsSize(num_azim);
+	size_t segments_start = 0;
+
+	if (matches && map_size >= offsets_start) {
+		int total_tracks = 0;
+
+		for (int i = 0; i < num_azim; i++) {
+			matches &= track_counts[i] == num_tracks[i];
+			total_tracks += num_tracks[i];
+		}
+
+		matches &= header->_num_tracks == total_tracks;
+
+		segments_start = offsets_start +
+							(header->_num_tracks + 1) * sizeof(int64_t);
+		matches &= map_size == segments_start +
+							header->_num_segments * sizeof(shared_segment);
+	}
+	else
+		matches = false;
+
+	if (!matches) {
+		log_printf(WARNING, "Segment database %s does not match the tracks "
+						"of this geometry and will not be used", path);
+		munmap(map, map_size);
+		return false;
+	}
+
+	if (_map != NULL)
+		munmap(_map, _map_size);
+
+	_path = path;
+	_map = map;
+	_map_size = map_size;
+	_num_azim = num_azim;
+	_num_FSRs = num_FSRs;
+	_track_offsets = (const int64_t*)(data + offsets_start);
+	_segments = (const shared_segment*)(data + segments_start);
+
+	_azim_offsets.resize(num_azim);
+	for (int i = 0, index = 0; i < num_azim; i++) {
+		_azim_offsets[i] = index;
+		index += num_tracks[i];
+	}
+
+	log_printf(NORMAL, "Mapped %ld segments from segment database %s",
+				(long)header->_num_segments, path);
+
+	return true;
+}
+
+
+/**
+ * Returns the number of segments along a track
+ * @param azim the track's azimuthal angle index
+ * @param track the track's index for its azimuthal angle
+ * @return the number of segments
+ */
+int SegmentDatabase::getNumSegments(int azim, int track) const {
+	int index = _azim_offsets[azim] + track;
+	return _track_offsets[index + 1] - _track_offsets[index];
+}
+
+
+/**
+ * Returns the segments along a track in order from its start point
+ * @param azim the track's azimuthal angle index
+ * @param track the track's index for its azimuthal angle
+ * @return a pointer to the track's first segment
+ */
+const shared_segment* SegmentDatabase::getSegments(int azim,
+												int track) const {
+	return &_segments[_track_offsets[_azim_offsets[azim] + track]];
+}
+
+
+/**
+ * Returns the number of segments along all tracks
+ * @return the total number of segments
+ */
+int64_t SegmentDatabase::getTotalNumSegments() const {
+	if (_map == NULL)
+		return 0;
+	return ((const database_header*)_map)->_num_segments;
+}
+
+
+/**
+ * Returns the size of the mapped database file
+ * @return the size in bytes
+ */
+size_t SegmentDatabase::getSize() const {
+	return _map_size;
+}
+
+
+/**
+ * Returns the path of the mapped database file
+ * @return the path
+ */
+std::string SegmentDatabase::getPath() const {
+	return _path;
+}
@@ -0,0 +1,61 @@
+/*
+ * SegmentDatabase.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ *  File-backed store of the segments of all tracks which is mapped
+ *  read-only so that processes solving the same geometry share one copy
+ *
+ */
+
+#ifndef SEGMENTDATABASE_H_
+#define SEGMENTDATABASE_H_
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Track.h"
+#include "log.h"
+
+/* Segment of a track in the database. It holds no pointers so that the
+ * database can be mapped at any address in each process */
+struct shared_segment {
+	double _length;
+	int _region_id;
+	int _material_id;
+};
+
+class SegmentDatabase {
+private:
+	std::string _path;
+	void* _map;
+	size_t _map_size;
+	int _num_azim;
+	int _num_FSRs;
+	/* Index of the first track of each azimuthal angle */
+	std::vector<int> _azim_offsets;
+	/* Index of the first segment of each track, with one extra entry for
+	 * the end of the last track */
+	const int64_t* _track_offsets;
+	const shared_segment* _segments;
+public:
+	SegmentDatabase();
+	virtual ~SegmentDatabase();
+	static bool write(const char* path, Track** tracks, int* num_tracks,
+						int num_azim, double spacing, int num_FSRs);
+	bool map(const char* path, int* num_tracks, int num_azim,
+						double spacing, int num_FSRs);
+	int getNumSegments(int azim, int track) const;
+	const shared_segment* getSegments(int azim, int track) const;
+	int64_t getTotalNumSegments() const;
+	size_t getSize() const;
+	std::string getPath() const;
+};
+
+#endif /* SEGMENTDATABASE_H_ */
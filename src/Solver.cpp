@@ -9,6 +9,9 @@
 
 #include "Solver.h"
 
+/* Identifies and versions the binary checkpoint file format */
+static const char CHECKPOINT_ID[8] = {'O', 'M', 'O', 'C', 'C', 'K', 'P', '1'};
+
 
 /**
  * Solver constructor
@@ -20,14 +23,78 @@ Solver::Solver(Geometry* geom, TrackGenerator* track_generator,
 	_geom = geom;
 	_quad = new Quadrature(TABUCHI);
 	_num_FSRs = geom->getNumFSRs();
+	_track_generator = track_generator;
 	_tracks = track_generator->getTracks();
 	_num_tracks = track_generator->getNumTracks();
 	_num_azim = track_generator->getNumAzim();
+	_segment_database = track_generator->getSegmentDatabase();
+#if USE_MPI
+	_domain = track_generator->getDomainDecomposition();
+#endif
 	_plotter = plotter;
+
+	/* Arnoldi eigenvalue solver defaults */
+	_compute_second_eigenvalue = false;
+	_k_eff_2 = 0.0;
+	_num_arnoldi_vectors = 10;
+	_num_gmres_vectors = 30;
+	_gmres_tolerance = 1E-8;
+
+	/* Jacobi iteration in energy by default */
+	_energy_gauss_seidel = false;
+	_num_upscatter_iterations = 1;
+
+	/* Sweep all energy groups until they have all converged by default */
+	_skip_converged_groups = false;
+
+	/* Stop the source iteration on the change in k_eff only by default */
+	_keff_tolerance = KEFF_CONVERG_THRESH;
+	_source_tolerance = 0.0;
+	_source_norm = L2_NORM;
+	_flux_tolerance = 0.0;
+
+	/* No checkpoint or restart files by default */
+	_checkpoint_interval = 0;
+
+	/* Each solve starts from a flat flux by default */
+	_warm_start = false;
+	_num_iterations = 0;
+
+	/* No coarse mesh rebalance by default */
+	_coarse_mesh_rebalance = false;
+	_FSRs_to_mesh_cells = NULL;
+
+	_num_material_buckets = 0;
+	_material_buckets = NULL;
+	_material_bucket_offsets = NULL;
+	_material_bucket_FSRs = NULL;
+#if STORE_PREFACTORS
+	_material_bucket_segments = NULL;
+	_material_bucket_segment_offsets = NULL;
+#endif
+
+	/* No batched solve until computeKeffBatch is called */
+	_batch_size = 0;
+	_pre_factor_array = NULL;
+
+	_num_polar_fluxes = 0;
+	for (int i = 0; i < _num_azim; i++)
+		_num_polar_fluxes += _num_tracks[i] * 2 * GRP_TIMES_ANG;
+
 	try{
 		_flat_source_regions = new FlatSourceRegion[_num_FSRs];
+		_scalar_flux = new double[_num_FSRs * NUM_ENERGY_GROUPS];
+		_old_scalar_flux = new double[_num_FSRs * NUM_ENERGY_GROUPS];
+		_source = new double[_num_FSRs * NUM_ENERGY_GROUPS];
+		_old_source = new double[_num_FSRs * NUM_ENERGY_GROUPS];
+		_ratios = new double[_num_FSRs * NUM_ENERGY_GROUPS];
+#if USE_OPENMP
+		_FSR_locks = new omp_lock_t[_num_FSRs];
+#endif
 		_FSRs_to_powers = new double[_num_FSRs];
 		_FSRs_to_pin_powers = new double[_num_FSRs];
+		_FSRs_to_fission_source = new double[_num_FSRs];
+		_old_fission_source_dist = new double[_num_FSRs];
 
 		for (int e = 0; e <= NUM_ENERGY_GROUPS; e++) {
 			_FSRs_to_fluxes[e] = new double[_num_FSRs];
@@ -40,6 +107,33 @@ Solver::Solver(Geometry* geom, TrackGenerator* track_generator,
 					"source region array. Backtrace:%s", e.what());
 	}
 
+	/* Zero the FSR arrays and point each FSR at its entries in them. The
+	 * arrays are first touched in parallel with the same static schedule as
+	 * the loops over the FSRs, so that each thread's FSRs are allocated on
+	 * its own socket */
+	#if USE_OPENMP
+	#pragma omp parallel for schedule(static)
+	#endif
+	for (int r = 0; r < _num_FSRs; r++) {
+		for (int e = 0; e < NUM_ENERGY_GROUPS; e++) {
+			_scalar_flux[FSR_INDEX(r, e)] = 0.0;
+			_old_scalar_flux[FSR_INDEX(r, e)] = 0.0;
+			_source[FSR_INDEX(r, e)] = 0.0;
+			_old_source[FSR_INDEX(r, e)] = 0.0;
+			_ratios[FSR_INDEX(r, e)] = 0.0;
+		}
+
+		_old_fission_source_dist[r] = 0.0;
+		_flat_source_regions[r].setStorage(&_scalar_flux[FSR_INDEX(r, 0)],
+				&_old_scalar_flux[FSR_INDEX(r, 0)], &_source[FSR_INDEX(r, 0)],
+				&_old_source[FSR_INDEX(r, 0)], &_ratios[FSR_INDEX(r, 0)],
+				FSR_INDEX(r, 1) - FSR_INDEX(r, 0));
+#if USE_OPENMP
+		omp_init_lock(&_FSR_locks[r]);
+		_flat_source_regions[r].setFluxLock(&_FSR_locks[r]);
+#endif
+	}
+
 	/* Pre-compute exponential pre-factors */
 	precomputeFactors();
 	initializeFSRs();
@@ -52,16 +146,40 @@ Solver::Solver(Geometry* geom, TrackGenerator* track_generator,
 Solver::~Solver() {
 
 	delete [] _flat_source_regions;
+	delete [] _scalar_flux;
+	delete [] _old_scalar_flux;
+	delete [] _source;
+	delete [] _old_source;
+	delete [] _ratios;
+
+#if USE_OPENMP
+	for (int r = 0; r < _num_FSRs; r++)
+		omp_destroy_lock(&_FSR_locks[r]);
+	delete [] _FSR_locks;
+#endif
+
 	delete [] _FSRs_to_powers;
 	delete [] _FSRs_to_pin_powers;
+	delete [] _FSRs_to_fission_source;
+	delete [] _old_fission_source_dist;
+
+	if (_FSRs_to_mesh_cells != NULL)
+		delete [] _FSRs_to_mesh_cells;
+
+	delete [] _material_buckets;
+	delete [] _material_bucket_offsets;
+	delete [] _material_bucket_FSRs;
+#if STORE_PREFACTORS
+	delete [] _material_bucket_segments;
+	delete [] _material_bucket_segment_offsets;
+#endif
 	delete _quad;
 
 	for (int e = 0; e <= NUM_ENERGY_GROUPS; e++)
 		delete [] _FSRs_to_fluxes[e];
 
-#if !STORE_PREFACTORS
-	delete [] _pre_factor_array;
-#endif
+	if (_pre_factor_array != NULL)
+		delete [] _pre_factor_array;
 
 }
 
@@ -124,11 +242,28 @@ void Solver::precomputeFactors() {
 		}
 	}
 
+	/* Shared segments are read-only and use the table instead */
+	if (_segment_database != NULL)
+		initializePreFactorArray();
 
 
 /* Use hash map */
 #else
 
+	initializePreFactorArray();
+
+#endif
+
+	return;
+}
+
+
+/**
+ * Makes the table of the exponential pre-factors for a linear
+ * interpolation in the product of sigma_t and the segment length
+ */
+void Solver::initializePreFactorArray() {
+
 	/* make pre factor array based on table look up with linear interpolation */
 
 	log_printf(NORMAL, "Making Prefactor array...");
@@ -159,8 +294,6 @@ void Solver::precomputeFactors() {
 		}
 	}
 
-#endif
-
 	return;
 }
 
@@ -181,17 +314,166 @@ double Solver::computePreFactor(segment* seg, int energy, int angle) {
 }
 
 
+/**
+ * Refreshes the solver for materials whose cross-sections have been
+ * replaced in place, e.g. by Geometry::updateMaterial. Only the exponential
+ * pre-factors of the segments and the source / sigma_t ratios of the FSRs
+ * in these materials are recomputed, while the tracks, fluxes and sources
+ * are kept. The pre-factor table used when pre-factors are not stored in
+ * the segments does not depend on the cross-sections and is left unchanged
+ * @param materials the materials whose cross-sections have changed
+ */
+void Solver::updateMaterials(std::vector<Material*> materials) {
+
+	double* sigma_t;
+	int r;
+#if STORE_PREFACTORS
+	segment* curr_seg;
+#endif
+
+	if (materials.empty())
+		return;
+
+	log_printf(INFO, "Updating the pre-factors and ratios for %d "
+						"materials...", (int)materials.size());
+
+	for (int b = 0; b < _num_material_buckets; b++) {
+		if (std::find(materials.begin(), materials.end(),
+						_material_buckets[b]) == materials.end())
+			continue;
+
+		sigma_t = _material_buckets[b]->getSigmaT();
+
+#if STORE_PREFACTORS
+		#if USE_OPENMP
+		#pragma omp parallel for private(curr_seg)
+		#endif
+		for (int i = _material_bucket_segment_offsets[b];
+						i < _material_bucket_segment_offsets[b+1]; i++) {
+			curr_seg = _material_bucket_segments[i];
+
+			for (int e = 0; e < NUM_ENERGY_GROUPS; e++) {
+				for (int p = 0; p < NUM_POLAR_ANGLES; p++)
+					curr_seg->_prefactors[e][p] =
+								computePreFactor(curr_seg, e, p);
+			}
+		}
+#endif
+
+		#if USE_OPENMP
+		#pragma omp parallel for private(r)
+		#endif
+		for (int i = _material_bucket_offsets[b];
+							i < _material_bucket_offsets[b+1]; i++) {
+			r = _material_bucket_FSRs[i];
+
+			for (int e = 0; e < NUM_ENERGY_GROUPS; e++)
+				_ratios[FSR_INDEX(r, e)] = _source[FSR_INDEX(r, e)] /
+																sigma_t[e];
+		}
+	}
+
+	return;
+}
+
+
+/**
+ * Fills a lattice cell with a different universe with the same number of
+ * FSRs and updates the solver for the new geometry. Only the tracks which
+ * cross the lattice cell are segmented again. The volumes of the FSRs
+ * crossed by these tracks are corrected for the old and new segments, the
+ * FSRs' materials are updated, the new segments' pre-factors are computed
+ * and the material buckets are rebuilt. The fluxes are kept as the initial
+ * guess for the next solve
+ * @param lattice_id the lattice id
+ * @param lattice_x the x index of the lattice cell
+ * @param lattice_y the y index of the lattice cell
+ * @param universe_id the id of the universe to fill the lattice cell with
+ * @return whether or not the universe was swapped
+ */
+bool Solver::swapLatticeUniverse(int lattice_id, int lattice_x,
+										int lattice_y, int universe_id) {
+
+	std::vector<Track*> tracks;
+	Track* track;
+	segment* seg;
+
+	if (_segment_database != NULL) {
+		log_printf(WARNING, "Unable to swap a lattice universe since the "
+					"segments are shared read-only in %s",
+					_segment_database->getPath().c_str());
+		return false;
+	}
+
+	if (!_geom->swapLatticeUniverse(lattice_id, lattice_x, lattice_y,
+														universe_id))
+		return false;
+
+	tracks = _geom->getLatticeCellTracks(lattice_id, lattice_x, lattice_y);
+
+	log_printf(NORMAL, "Segmenting %d tracks across lattice id = %d at "
+			"x = %d, y = %d...", (int)tracks.size(), lattice_id, lattice_x,
+			lattice_y);
+
+	for (unsigned int t = 0; t < tracks.size(); t++) {
+		track = tracks[t];
+
+		/* Remove the old segments from the FSR volumes */
+		for (int s = 0; s < track->getNumSegments(); s++) {
+			seg = track->getSegment(s);
+			_flat_source_regions[seg->_region_id].incrementVolume(
+						-seg->_length * track->getAzimuthalWeight());
+		}
+
+		track->clearSegments();
+		_geom->segmentize(track);
+
+		for (int s = 0; s < track->getNumSegments(); s++) {
+			seg = track->getSegment(s);
+			_flat_source_regions[seg->_region_id].incrementVolume(
+						seg->_length * track->getAzimuthalWeight());
+			_flat_source_regions[seg->_region_id].setMaterial(seg->_material);
+
+#if STORE_PREFACTORS
+			for (int e = 0; e < NUM_ENERGY_GROUPS; e++) {
+				for (int p = 0; p < NUM_POLAR_ANGLES; p++)
+					seg->_prefactors[e][p] = computePreFactor(seg, e, p);
+			}
+#endif
+		}
+	}
+
+	/* Group the FSRs and segments by their new materials */
+	delete [] _material_buckets;
+	delete [] _material_bucket_offsets;
+	delete [] _material_bucket_FSRs;
+#if STORE_PREFACTORS
+	delete [] _material_bucket_segments;
+	delete [] _material_bucket_segment_offsets;
+#endif
+	initializeMaterialBuckets();
+
+	return true;
+}
+
+
 /**
  * Compute the ratio of source / sigma_t for each energy group in each flat
  * source region for efficient fixed source iteration
  */
 void Solver::computeRatios() {
 
+	double* sigma_t;
+
 	#if USE_OPENMP
-	#pragma omp parallel for
+	#pragma omp parallel for private(sigma_t)
 	#endif
-	for (int i = 0; i < _num_FSRs; i++)
-		_flat_source_regions[i].computeRatios();
+	for (int r = 0; r < _num_FSRs; r++) {
+		sigma_t = _flat_source_regions[r].getMaterial()->getSigmaT();
+
+		for (int e = 0; e < NUM_ENERGY_GROUPS; e++)
+			_ratios[FSR_INDEX(r, e)] = _source[FSR_INDEX(r, e)] / sigma_t[e];
+	}
 
 	return;
 }
@@ -212,6 +494,7 @@ void Solver::initializeFSRs() {
 	Universe* univ_zero = _geom->getUniverse(0);
 	Track* track;
 	segment* seg;
+	const shared_segment* shared_seg;
 	FlatSourceRegion* fsr;
 
 	/* Set each FSR's volume by accumulating the total length of all
@@ -225,9 +508,34 @@ void Solver::initializeFSRs() {
 				fsr =&_flat_source_regions[seg->_region_id];
 				fsr->incrementVolume(seg->_length * track->getAzimuthalWeight());
 			}
+
+			if (_segment_database == NULL)
+				continue;
+
+			shared_seg = _segment_database->getSegments(i, j);
+			for (int s = 0; s < _segment_database->getNumSegments(i, j); s++) {
+				fsr = &_flat_source_regions[shared_seg[s]._region_id];
+				fsr->incrementVolume(shared_seg[s]._length *
+										track->getAzimuthalWeight());
+			}
 		}
 	}
 
+#if USE_MPI
+	/* Add up the volumes of FSRs which are cut by subdomain boundaries */
+	if (_domain != NULL) {
+		std::vector<double> volumes(_num_FSRs);
+
+		for (int r = 0; r < _num_FSRs; r++)
+			volumes[r] = _flat_source_regions[r].getVolume();
+
+		_domain->sum(&volumes[0], _num_FSRs);
+
+		for (int r = 0; r < _num_FSRs; r++)
+			_flat_source_regions[r].setVolume(volumes[r]);
+	}
+#endif
+
 	/* Loop over all FSRs */
 	#if USE_OPENMP
 	#pragma omp parallel for private(cell, material)
@@ -237,17 +545,108 @@ void Solver::initializeFSRs() {
 		_flat_source_regions[r].setId(r);
 
 		/* Get the cell corresponding to this FSR from the geometry */
-		cell = static_cast<CellBasic*>(_geom->findCell(univ_zero, r));
+		cell = static_cast<CellBasic*>(_geom->findCell(univ_zero,
+												_geom->getExternalFSRId(r)));
 
 		/* Get the cell's material and assign it to the FSR */
 		material = _geom->getMaterial(cell->getMaterial());
 		_flat_source_regions[r].setMaterial(material);
 
 		log_printf(INFO, "FSR id = %d has cell id = %d and material id = %d "
-				"and volume = %f", r, cell->getId(), material->getId(),
+				"and volume = %f", _geom->getExternalFSRId(r), cell->getId(),
+				material->getId(),
 				_flat_source_regions[r].getVolume());
 	}
 
+	initializeMaterialBuckets();
+
+	return;
+}
+
+
+/**
+ * Groups the FSR ids, and the segments if pre-factors are stored in them,
+ * by material so that the source and reaction rate
+ * loops can fetch each material's cross sections once and apply them to
+ * all of the material's FSRs while they are in cache. Buckets are ordered
+ * by material id and the FSRs in each bucket by FSR id
+ */
+void Solver::initializeMaterialBuckets() {
+
+	std::map<int, std::vector<int> > material_FSRs;
+	std::map<int, std::vector<int> >::iterator iter;
+	std::map<int, Material*> materials;
+	Material* material;
+	int index = 0;
+
+	for (int r = 0; r < _num_FSRs; r++) {
+		material = _flat_source_regions[r].getMaterial();
+		material_FSRs[material->getId()].push_back(r);
+		materials[material->getId()] = material;
+	}
+
+	_num_material_buckets = material_FSRs.size();
+	_material_buckets = new Material*[_num_material_buckets];
+	_material_bucket_offsets = new int[_num_material_buckets + 1];
+	_material_bucket_FSRs = new int[_num_FSRs];
+
+	int b = 0;
+	for (iter = material_FSRs.begin(); iter != material_FSRs.end(); ++iter) {
+		_material_buckets[b] = materials[iter->first];
+		_material_bucket_offsets[b] = index;
+
+		for (unsigned int i = 0; i < iter->second.size(); i++)
+			_material_bucket_FSRs[index++] = iter->second[i];
+
+		b++;
+	}
+
+	_material_bucket_offsets[_num_material_buckets] = index;
+
+#if STORE_PREFACTORS
+	/* Index the segments of each bucket so that the pre-factors of a
+	 * material can be updated without looping over all segments */
+	std::map<Material*, int> material_buckets;
+	std::vector<std::vector<segment*> > bucket_segments(_num_material_buckets);
+	Track* track;
+	segment* seg;
+
+	for (b = 0; b < _num_material_buckets; b++)
+		material_buckets[_material_buckets[b]] = b;
+
+	for (int i = 0; i < _num_azim; i++) {
+		for (int j = 0; j < _num_tracks[i]; j++) {
+			track = &_tracks[i][j];
+
+			for (int s = 0; s < track->getNumSegments(); s++) {
+				seg = track->getSegment(s);
+				bucket_segments[material_buckets[seg->_material]].push_back(seg);
+			}
+		}
+	}
+
+	_material_bucket_segment_offsets = new int[_num_material_buckets + 1];
+	index = 0;
+
+	for (b = 0; b < _num_material_buckets; b++)
+		index += bucket_segments[b].size();
+
+	_material_bucket_segments = new segment*[index];
+	index = 0;
+
+	for (b = 0; b < _num_material_buckets; b++) {
+		_material_bucket_segment_offsets[b] = index;
+
+		for (unsigned int s = 0; s < bucket_segments[b].size(); s++)
+			_material_bucket_segments[index++] = bucket_segments[b][s];
+	}
+
+	_material_bucket_segment_offsets[_num_material_buckets] = index;
+#endif
+
+	log_printf(INFO, "Grouped %d FSRs into %d material buckets", _num_FSRs,
+												_num_material_buckets);
+
 	return;
 }
 
@@ -284,17 +683,13 @@ void Solver::zeroTrackFluxes() {
 void Solver::oneFSRFluxes() {
 
 	log_printf(INFO, "Setting all FSR scalar fluxes to unity...");
-	FlatSourceRegion* fsr;
 
 	/* Loop over all FSRs and energy groups */
 	#if USE_OPENMP
-	#pragma omp parallel for private(fsr)
+	#pragma omp parallel for
 	#endif
-	for (int r = 0; r < _num_FSRs; r++) {
-		fsr = &_flat_source_regions[r];
-		for (int e = 0; e < NUM_ENERGY_GROUPS; e++)
-			fsr->setFlux(e, 1.0);
-	}
+	for (int i = 0; i < _num_FSRs * NUM_ENERGY_GROUPS; i++)
+		_scalar_flux[i] = 1.0;
 
 	return;
 }
@@ -306,17 +701,13 @@ void Solver::oneFSRFluxes() {
 void Solver::zeroFSRFluxes() {
 
 	log_printf(INFO, "Setting all FSR scalar fluxes to zero...");
-	FlatSourceRegion* fsr;
 
 	/* Loop over all FSRs and energy groups */
 	#if USE_OPENMP
-	#pragma omp for private(fsr)
+	#pragma omp parallel for
 	#endif
-	for (int r = 0; r < _num_FSRs; r++) {
-		fsr = &_flat_source_regions[r];
-		for (int e = 0; e < NUM_ENERGY_GROUPS; e++)
-			fsr->setFlux(e, 0.0);
-	}
+	for (int i = 0; i < _num_FSRs * NUM_ENERGY_GROUPS; i++)
+		_scalar_flux[i] = 0.0;
 
 	return;
 }
@@ -334,43 +725,40 @@ void Solver::updateKeff() {
 	double fission;
 	double* sigma_a;
 	double* nu_sigma_f;
-	double* flux;
+	double volume;
 	Material* material;
-	FlatSourceRegion* fsr;
+	int r, start_index, end_index;
 
-#if USE_OPENMP
-#pragma omp parallel shared(tot_abs, tot_fission)
-{
-	#pragma omp for private(fsr, material, sigma_a, nu_sigma_f, flux, abs, fission)
-	#endif
-	for (int r = 0; r < _num_FSRs; r++) {
-		abs = 0;
-		fission = 0;
-		fsr = &_flat_source_regions[r];
-		material = fsr->getMaterial();
+	/* Loop over the FSRs one material at a time */
+	for (int b = 0; b < _num_material_buckets; b++) {
+		material = _material_buckets[b];
 		sigma_a = material->getSigmaA();
 		nu_sigma_f = material->getNuSigmaF();
-		flux = fsr->getFlux();
+		start_index = material->getNuSigmaFStart();
+		end_index = material->getNuSigmaFEnd();
 
-		for (int e = 0; e < NUM_ENERGY_GROUPS; e++) {
-			abs += sigma_a[e] * flux[e] * fsr->getVolume();
-			fission += nu_sigma_f[e] * flux[e] * fsr->getVolume();
-		}
+		#if USE_OPENMP
+		#pragma omp parallel for private(r, volume, abs, fission) \
+				reduction(+:tot_abs, tot_fission)
+		#endif
+		for (int i = _material_bucket_offsets[b];
+							i < _material_bucket_offsets[b+1]; i++) {
+			r = _material_bucket_FSRs[i];
+			volume = _flat_source_regions[r].getVolume();
+			abs = 0;
+			fission = 0;
 
-			#if USE_OPENMP
-			#pragma omp atomic
-			#endif
-			tot_abs += abs;
+			for (int e = 0; e < NUM_ENERGY_GROUPS; e++)
+				abs += sigma_a[e] * _scalar_flux[FSR_INDEX(r, e)];
 
-			#if USE_OPENMP
-			#pragma omp atomic
-			#endif
-			tot_fission += fission;
-	}
+			/* Non-fissile materials have an empty nu_sigma_f range */
+			for (int e = start_index; e < end_index; e++)
+				fission += nu_sigma_f[e] * _scalar_flux[FSR_INDEX(r, e)];
 
-#if USE_OPENMP
-}
-#endif
+			tot_abs += abs * volume;
+			tot_fission += fission * volume;
+		}
+	}
 
 	_k_eff = tot_fission/tot_abs;
 	log_printf(INFO, "Computed k_eff = %f", _k_eff);
@@ -419,20 +807,33 @@ void Solver::checkTrackSpacing() {
 				segment = segments.at(s);
 				FSR_segment_tallies[segment->_region_id]++;
 			}
+
+			if (_segment_database == NULL)
+				continue;
+
+			for (int s = 0; s < _segment_database->getNumSegments(i, j); s++)
+				FSR_segment_tallies[_segment_database->getSegments(i, j)[s].
+															_region_id]++;
 		}
 	}
 
+#if USE_MPI
+	/* Count the segments in all subdomains */
+	if (_domain != NULL)
+		_domain->sum(FSR_segment_tallies, _num_FSRs);
+#endif
 
 	/* Loop over all FSRs and if one FSR does not have tracks in it, print
 	 * error message to the screen and exit program 
     */
 	for (int i=0; i < _num_FSRs; i++) {
 		if (FSR_segment_tallies[i] == 0) {
-			cell = _geom->findCell(i);
+			cell = _geom->findCell(_geom->getExternalFSRId(i));
 			log_printf(ERROR, "No tracks were tallied inside FSR id = %d which "
 					"is cell id = %d. Please reduce your track spacing,"
 					" increase the number of azimuthal angles, or increase the"
-					" size of the flat source regions", i, cell->getId());
+					" size of the flat source regions",
+					_geom->getExternalFSRId(i), cell->getId());
 		}
 	}
 
@@ -441,628 +842,3517 @@ void Solver::checkTrackSpacing() {
 
 
 /**
- * Compute the fission rates in each FSR and save them in a map of
- * FSR ids to fission rates
+ * Attenuates the angular fluxes in one direction across a segment for a
+ * list of energy groups and adds the change in each one, weighted by its
+ * polar angle, to the segment's FSR flux tally
+ * @param seg the segment
+ * @param polar_fluxes the angular fluxes in the direction of the sweep
+ * @param weights the track's polar weights
+ * @param groups the energy groups to sweep
+ * @param num_groups the number of energy groups in the list
+ * @param fsr_flux the FSR flux tally for each energy group
  */
-void Solver::computePinPowers() {
+inline void Solver::attenuateFluxes(segment* seg, double* polar_fluxes,
+						double* weights, int* groups, int num_groups,
+						double* fsr_flux) {
 
-	log_printf(NORMAL, "Computing pin powers...");
+	int fsr_id = seg->_region_id;
+	double delta;
+	int p, g, e, pe;
+#if !STORE_PREFACTORS
+	double* sigma_t = seg->_material->getSigmaT();
+	double sigma_t_l;
+	int index;
 
-	FlatSourceRegion* fsr;
-	double tot_pin_power = 0;
-	double avg_pin_power = 0;
-	double num_nonzero_pins = 0;
-	double curr_pin_power = 0;
-	double prev_pin_power = 0;
+	for (g = 0; g < num_groups; g++) {
+		e = groups[g];
+
+		/* Initialize the polar angle and energy group counter */
+		pe = e * NUM_POLAR_ANGLES;
+
+		sigma_t_l = sigma_t[e] * seg->_length;
+		sigma_t_l = std::min(sigma_t_l,10.0);
+		index = sigma_t_l / _pre_factor_spacing;
+		index = std::min(index * 2 * NUM_POLAR_ANGLES,
+								_pre_factor_max_index);
+
+		for (p = 0; p < NUM_POLAR_ANGLES; p++){
+			delta = (polar_fluxes[pe] - _ratios[FSR_INDEX(fsr_id, e)]) *
+			(1 - (_pre_factor_array[index + 2 * p] * sigma_t_l
+			+ _pre_factor_array[index + 2 * p + 1]));
+			fsr_flux[e] += delta * weights[p];
+			polar_fluxes[pe] -= delta;
+			pe++;
+		}
+	}
 
-	/* create BitMaps for plotting */
-	BitMap<int>* bitMapFSR = new BitMap<int>;
-	BitMap<float>* bitMap = new BitMap<float>;
-	bitMapFSR->pixel_x = _plotter->getBitLengthX();
-	bitMapFSR->pixel_y = _plotter->getBitLengthY();
-	bitMap->pixel_x = _plotter->getBitLengthX();
-	bitMap->pixel_y = _plotter->getBitLengthY();
-	initialize(bitMapFSR);
-	initialize(bitMap);
-	bitMap->geom_x = _geom->getWidth();
-	bitMap->geom_y = _geom->getHeight();
-	bitMapFSR->color_type = RANDOM;
-	bitMap->color_type = SCALED;
+#else
+	/* Loop over all polar angles and active energy groups */
+	for (g = 0; g < num_groups; g++) {
+		e = groups[g];
+
+		/* Initialize the polar angle and energy group counter */
+		pe = e * NUM_POLAR_ANGLES;
+
+		for (p = 0; p < NUM_POLAR_ANGLES; p++) {
+			delta = (polar_fluxes[pe] - _ratios[FSR_INDEX(fsr_id, e)]) *
+									seg->_prefactors[e][p];
+			fsr_flux[e] += delta * weights[p];
+			polar_fluxes[pe] -= delta;
+			pe++;
+		}
+	}
+#endif
+}
 
-	/* make FSR BitMap */
-	_plotter->makeFSRMap(bitMapFSR->pixels);
 
-	/* Loop over all FSRs and compute the fission rate*/
-	for (int i=0; i < _num_FSRs; i++) {
-		fsr = &_flat_source_regions[i];
-		_FSRs_to_powers[i] = fsr->computeFissionRate();
-	}
+#if CMFD_ACCEL
+/**
+ * Tallies the current and flux of the angular fluxes crossing a CMFD mesh
+ * surface at the end of a segment for a list of energy groups
+ * @param mesh_surface the mesh surface, or NULL if the segment does not
+ *        end on one
+ * @param polar_fluxes the angular fluxes in the direction of the sweep
+ * @param weights the track's polar weights
+ * @param phi the track's azimuthal angle
+ * @param groups the energy groups to tally
+ * @param num_groups the number of energy groups in the list
+ */
+inline void Solver::tallyMeshSurface(MeshSurface* mesh_surface,
+						double* polar_fluxes, double* weights, double phi,
+						int* groups, int num_groups) {
 
-	/* Compute the pin powers by adding up the powers of FSRs in each
-	 * lattice cell, saving lattice cell powers to files, and saving the
-	 * pin power corresponding to each FSR id in FSR_to_pin_powers */
-	_geom->computePinPowers(_FSRs_to_powers, _FSRs_to_pin_powers);
+	int p, g, e, pe;
 
+	if (mesh_surface == NULL)
+		return;
 
-	/* Compute the total power based by accumulating the power of each unique
-	 * pin with a nonzero power */
-	for (int i=0; i < _num_FSRs; i++) {
-		curr_pin_power = _FSRs_to_pin_powers[i];
+	for (g = 0; g < num_groups; g++) {
+		e = groups[g];
+		pe = e * NUM_POLAR_ANGLES;
 
-		/* If this pin power is unique and nozero (doesn't match the previous
-		 * pin's power), then tally it
-		 */
-		if (curr_pin_power > 0 && curr_pin_power != prev_pin_power) {
-			tot_pin_power += curr_pin_power;
-			num_nonzero_pins++;
-			prev_pin_power = curr_pin_power;
+		for (p = 0; p < NUM_POLAR_ANGLES; p++){
+			/* increment current (polar and azimuthal weighted flux, group)*/
+			mesh_surface->incrementCurrent(polar_fluxes[pe] * weights[p], phi, e);
+			mesh_surface->incrementFlux(polar_fluxes[pe] * weights[p], e);
+			pe++;
 		}
 	}
+}
+#endif
 
-	/* Compute the average pin power */
-	avg_pin_power = tot_pin_power / num_nonzero_pins;
 
-	/* Normalize each pin power to the average non-zero pin power */
-	for (int i=0; i < _num_FSRs; i++) {
-		_FSRs_to_pin_powers[i] /= avg_pin_power;
-	}
+/**
+ * Sweeps one track forward and backward along its segments for a list of
+ * energy groups, tallying the FSR fluxes and, if requested, the currents
+ * on the CMFD mesh surfaces, and passes the outgoing angular fluxes to the
+ * tracks they enter. The forward fluxes are advanced from the start point
+ * and the backward fluxes from the end point in the same pass over the
+ * segments, so that the track's segments are read once for both
+ * directions, and both directions' tallies are added to an FSR at once
+ * where they cross the same one
+ * @param track the track to sweep
+ * @param groups the energy groups to sweep
+ * @param num_groups the number of energy groups in the list
+ * @param cmfd whether or not to tally the mesh surface currents
+ */
+void Solver::sweepTrack(Track* track, int* groups, int num_groups,
+															bool cmfd) {
 
+	int num_segments;
+	std::vector<segment*> segments;
+	double* weights;
+	double* forward_fluxes;
+	double* backward_fluxes;
+	segment* forward_seg;
+	segment* backward_seg;
+	double forward_fsr_flux[NUM_ENERGY_GROUPS];
+	double backward_fsr_flux[NUM_ENERGY_GROUPS];
+	int i, e;
+
+	/* Initialize local pointers to important data structures */
+	segments = track->getSegments();
+	num_segments = track->getNumSegments();
+	weights = track->getPolarWeights();
+	forward_fluxes = track->getPolarFluxes();
+	backward_fluxes = forward_fluxes + GRP_TIMES_ANG;
+
+	/* Loop over the segments from both ends of the track at once */
+	for (i = 0; i < num_segments; i++) {
+		forward_seg = segments[i];
+		backward_seg = segments[num_segments - 1 - i];
+
+		/* Zero out temporary FSR flux arrays */
+		for (e = 0; e < NUM_ENERGY_GROUPS; e++) {
+			forward_fsr_flux[e] = 0.0;
+			backward_fsr_flux[e] = 0.0;
+		}
 
-	log_printf(NORMAL, "Plotting pin powers...");
-	_plotter->makeRegionMap(bitMapFSR->pixels, bitMap->pixels, _FSRs_to_pin_powers);
-	plot(bitMap, "pin_powers", _plotter->getExtension());
+		attenuateFluxes(forward_seg, forward_fluxes, weights, groups,
+										num_groups, forward_fsr_flux);
+		attenuateFluxes(backward_seg, backward_fluxes, weights, groups,
+										num_groups, backward_fsr_flux);
 
-	/* delete bitMaps */
-	deleteBitMap(bitMapFSR);
-	deleteBitMap(bitMap);
+#if CMFD_ACCEL
+		if (cmfd == true){
+			tallyMeshSurface(forward_seg->_mesh_surface_fwd, forward_fluxes,
+						weights, track->getPhi(), groups, num_groups);
+			tallyMeshSurface(backward_seg->_mesh_surface_bwd, backward_fluxes,
+						weights, track->getPhi(), groups, num_groups);
+		}
+#endif
 
-	return;
-}
+		/* Increment the scalar flux for the FSRs, only once if both
+		 * directions are inside the same one */
+		if (forward_seg->_region_id == backward_seg->_region_id) {
+			for (e = 0; e < NUM_ENERGY_GROUPS; e++)
+				forward_fsr_flux[e] += backward_fsr_flux[e];
 
+			_flat_source_regions[forward_seg->_region_id].incrementFlux(
+														forward_fsr_flux);
+		}
+		else {
+			_flat_source_regions[forward_seg->_region_id].incrementFlux(
+														forward_fsr_flux);
+			_flat_source_regions[backward_seg->_region_id].incrementFlux(
+														backward_fsr_flux);
+		}
+	}
+
+	/* Transfer flux to outgoing and incoming tracks */
+	track->getTrackOut()->setPolarFluxes(track->isReflOut(),
+							0, forward_fluxes, groups, num_groups);
+	track->getTrackIn()->setPolarFluxes(track->isReflIn(),
+				GRP_TIMES_ANG, forward_fluxes, groups, num_groups);
+}
 
 
-void Solver::fixedSourceIteration(int max_iterations, bool cmfd = false) {
+/**
+ * Sweeps one track along its segments in one direction for a list of
+ * energy groups, tallying the FSR fluxes and, if requested, the currents
+ * on the CMFD mesh surfaces, and passes the outgoing angular fluxes to the
+ * track they enter
+ * @param track the track to sweep
+ * @param reverse whether to sweep from the end point back to the start
+ * @param groups the energy groups to sweep
+ * @param num_groups the number of energy groups in the list
+ * @param cmfd whether or not to tally the mesh surface currents
+ */
+void Solver::sweepTrackDirection(Track* track, bool reverse, int* groups,
+												int num_groups, bool cmfd) {
 
-	Track* track;
 	int num_segments;
 	std::vector<segment*> segments;
 	double* weights;
-	segment* segment;
+	segment* seg;
 	double* polar_fluxes;
-	double* scalar_flux;
-	double* old_scalar_flux;
-	double* sigma_t;
-	FlatSourceRegion* fsr;
 	double fsr_flux[NUM_ENERGY_GROUPS];
-	double* ratios;
-	double delta;
-	double volume;
-	int t, j, k, s, p, e, pe;
-	int num_threads = _num_azim / 2;
-
-#if !STORE_PREFACTORS
-	double sigma_t_l;
-	int index;
-#endif
+	int i, e;
 
-	log_printf(INFO, "Fixed source iteration with max_iterations = %d and "
-			"# threads = %d", max_iterations, num_threads);
+	/* Initialize local pointers to important data structures. The forward
+	 * and reverse polar fluxes are stored one after the other */
+	segments = track->getSegments();
+	num_segments = track->getNumSegments();
+	weights = track->getPolarWeights();
+	polar_fluxes = track->getPolarFluxes() + reverse * GRP_TIMES_ANG;
 
-	/* Loop for until converged or max_iterations is reached */
-	for (int i = 0; i < max_iterations; i++) {
+	/* Loop over each segment in this direction */
+	for (i = 0; i < num_segments; i++) {
+		seg = segments[reverse ? num_segments - 1 - i : i];
 
-		/* Initialize flux in each region to zero */
-		zeroFSRFluxes();
+		/* Zero out temporary FSR flux array */
+		for (e = 0; e < NUM_ENERGY_GROUPS; e++)
+			fsr_flux[e] = 0.0;
 
+		attenuateFluxes(seg, polar_fluxes, weights, groups, num_groups,
+																fsr_flux);
 
 #if CMFD_ACCEL
-		if (cmfd == true){
-
-			/* zero surface currents */
-			Mesh* mesh = _geom->getMesh();
-			for (int cell = 0; cell < mesh->getCellHeight()*mesh->getCellWidth(); cell++){
-				for (int surface = 0; surface < 8; surface++){
-					for (int group = 0; group < NUM_ENERGY_GROUPS; group++){
-						mesh->getCells(cell)->getMeshSurfaces(surface)->setCurrent(0, group);
-						mesh->getCells(cell)->getMeshSurfaces(surface)->setFlux(0, group);
-					}
-				}
-			}
-		}
+		if (cmfd == true)
+			tallyMeshSurface(reverse ? seg->_mesh_surface_bwd :
+							seg->_mesh_surface_fwd, polar_fluxes, weights,
+							track->getPhi(), groups, num_groups);
 #endif
 
-		/* Loop over azimuthal each thread and azimuthal angle*
-		 * If we are using OpenMP then we create a separate thread
-		 * for each pair of reflecting azimuthal angles - angles which
-		 * wrap into cycles on each other */
-		#if USE_OPENMP && STORE_PREFACTORS
-		#pragma omp parallel for num_threads(num_threads) \
-				private(t, k, j, i, s, p, e, pe, track, segments, \
-						num_segments, weights, polar_fluxes,\
-						segment, fsr, ratios, delta, fsr_flux)
-		#elif USE_OPENMP && !STORE_PREFACTORS
-		#pragma omp parallel for num_threads(num_threads) \
-				private(t, k, j, i, s, p, e, pe, track, segments, \
-						num_segments, weights, polar_fluxes,\
-						segment, fsr, ratios, delta, fsr_flux,\
-						sigma_t_l, index)
-		#endif
-		/* Loop over each thread */
-		for (t=0; t < num_threads; t++) {
+		/* Increment the scalar flux for this FSR */
+		_flat_source_regions[seg->_region_id].incrementFlux(fsr_flux);
+	}
 
-			/* Loop over the pair of azimuthal angles for this thread */
-			j = t;
-			while (j < _num_azim) {
+	/* Transfer flux to the outgoing or incoming track */
+	if (reverse)
+		track->getTrackIn()->setPolarFluxes(track->isReflIn(),
+						GRP_TIMES_ANG, track->getPolarFluxes(), groups,
+						num_groups);
+	else
+		track->getTrackOut()->setPolarFluxes(track->isReflOut(),
+						0, track->getPolarFluxes(), groups, num_groups);
+}
 
-			/* Loop over all tracks for this azimuthal angles */
-			for (k = 0; k < _num_tracks[j]; k++) {
 
-				/* Initialize local pointers to important data structures */
-				track = &_tracks[j][k];
-				segments = track->getSegments();
-				num_segments = track->getNumSegments();
-				weights = track->getPolarWeights();
-				polar_fluxes = track->getPolarFluxes();
+/**
+ * Sweeps all tracks forward and backward along their own segments for a
+ * list of energy groups, tallying the FSR fluxes and, if requested, the
+ * currents on the CMFD mesh surfaces
+ * @param groups the energy groups to sweep
+ * @param num_groups the number of energy groups in the list
+ * @param cmfd whether or not to tally the mesh surface currents
+ */
+void Solver::sweepTrackSegments(int* groups, int num_groups, bool cmfd) {
 
-				/* Loop over each segment in forward direction */
-				for (s = 0; s < num_segments; s++) {
-					segment = segments.at(s);
-					fsr = &_flat_source_regions[segment->_region_id];
-					ratios = fsr->getRatios();
+	int t, j, k;
+	int num_threads = _num_azim / 2;
 
-					/* Zero out temporary FSR flux array */
-					for (e = 0; e < NUM_ENERGY_GROUPS; e++)
-						fsr_flux[e] = 0.0;
+	/* Loop over azimuthal each thread and azimuthal angle*
+	 * If we are using OpenMP then we create a separate thread
+	 * for each pair of reflecting azimuthal angles - angles which
+	 * wrap into cycles on each other */
+	#if USE_OPENMP
+	#pragma omp parallel for num_threads(num_threads) private(t, k, j)
+	#endif
+	/* Loop over each thread */
+	for (t=0; t < num_threads; t++) {
+
+		/* Loop over the pair of azimuthal angles for this thread */
+		j = t;
+		while (j < _num_azim) {
+
+		/* Loop over all tracks for this azimuthal angles */
+		for (k = 0; k < _num_tracks[j]; k++)
+			sweepTrack(&_tracks[j][k], groups, num_groups, cmfd);
+
+		/* Update the azimuthal angle index for this thread
+		 * such that the next azimuthal angle is the one that reflects
+		 * out of the current one. If instead this is the 2nd (final)
+		 * angle to be used by this thread, break loop */
+		if (j < num_threads)
+			j = _num_azim - j - 1;
+		else
+			break;
 
-					/* Initialize the polar angle and energy group counter */
-					pe = 0;
+		}
+	}
+}
 
-#if !STORE_PREFACTORS
-					sigma_t = segment->_material->getSigmaT();
 
-					for (e = 0; e < NUM_ENERGY_GROUPS; e++) {
+/**
+ * Sweeps the track pieces one tile at a time, so that the data of the FSRs
+ * inside a tile stays in cache while all of the pieces crossing it are
+ * swept. Each thread sweeps whole tiles, whose pieces are only linked
+ * directly to pieces in the same tile
+ * @param groups the energy groups to sweep
+ * @param num_groups the number of energy groups in the list
+ * @param cmfd whether or not to tally the mesh surface currents
+ */
+void Solver::sweepTiles(int* groups, int num_groups, bool cmfd) {
 
-						fsr_flux[e] = 0;
-						sigma_t_l = sigma_t[e] * segment->_length;
-						sigma_t_l = std::min(sigma_t_l,10.0);
-						index = sigma_t_l / _pre_factor_spacing;
-						index = std::min(index * 2 * NUM_POLAR_ANGLES,
-												_pre_factor_max_index);
+	int num_tiles = _track_generator->getNumTiles();
+	int* tile_offsets = _track_generator->getTileOffsets();
+	int* offsets;
 
-						for (p = 0; p < NUM_POLAR_ANGLES; p++){
-							delta = (polar_fluxes[pe] - ratios[e]) *
-							(1 - (_pre_factor_array[index + 2 * p] * sigma_t_l
-							+ _pre_factor_array[index + 2 * p + 1]));
-							fsr_flux[e] += delta * weights[p];
-							polar_fluxes[pe] -= delta;
-							pe++;
-						}
-					}
+	#if USE_OPENMP
+	#pragma omp parallel for schedule(dynamic) private(offsets)
+	#endif
+	for (int t = 0; t < num_tiles; t++) {
+		for (int i = 0; i < _num_azim; i++) {
+			offsets = &tile_offsets[i * (num_tiles + 1) + t];
 
-#else
-					/* Loop over all polar angles and energy groups */
-					for (e = 0; e < NUM_ENERGY_GROUPS; e++) {
-						for (p = 0; p < NUM_POLAR_ANGLES; p++) {
-							delta = (polar_fluxes[pe] -ratios[e]) *
-													segment->_prefactors[e][p];
-							fsr_flux[e] += delta * weights[p];
-							polar_fluxes[pe] -= delta;
-							pe++;
-						}
-					}
+			for (int j = offsets[0]; j < offsets[1]; j++)
+				sweepTrack(&_tracks[i][j], groups, num_groups, cmfd);
+		}
+	}
+}
 
-#endif
 
-#if CMFD_ACCEL
-					if (cmfd == true){
+/**
+ * Sweeps the track directions one chain at a time, each in the order its
+ * directions pass their outgoing angular fluxes on, so that each flux is
+ * used in the same iteration it is computed. Each thread sweeps whole
+ * chains, taking the longest ones first
+ * @param groups the energy groups to sweep
+ * @param num_groups the number of energy groups in the list
+ * @param cmfd whether or not to tally the mesh surface currents
+ */
+void Solver::sweepChains(int* groups, int num_groups, bool cmfd) {
 
-						if (segment->_mesh_surface_fwd != NULL){
-							pe = 0;
+	int num_chains = _track_generator->getNumChains();
+	const chain_link* links = _track_generator->getChainLinks();
+	const int* offsets = _track_generator->getChainOffsets();
 
-							for (e = 0; e < NUM_ENERGY_GROUPS; e++) {
-								for (p = 0; p < NUM_POLAR_ANGLES; p++){
-									/* increment current (polar and azimuthal weighted flux, group)*/
-									segment->_mesh_surface_fwd->incrementCurrent(polar_fluxes[pe] * weights[p], track->getPhi(), e);
-									segment->_mesh_surface_fwd->incrementFlux(polar_fluxes[pe] * weights[p], e);
-									pe++;
-								}
-							}
-						}
-					}
-#endif
+	#if USE_OPENMP
+	#pragma omp parallel for schedule(dynamic)
+	#endif
+	for (int c = 0; c < num_chains; c++) {
+		for (int l = offsets[c]; l < offsets[c+1]; l++)
+			sweepTrackDirection(links[l]._track, links[l]._reverse, groups,
+														num_groups, cmfd);
+	}
+}
 
 
-					/* Increment the scalar flux for this FSR */
-					fsr->incrementFlux(fsr_flux);
-				}
+/**
+ * Sweeps all tracks forward and backward along the segments in the shared
+ * segment database for a list of energy groups, tallying the FSR fluxes.
+ * The read-only segments hold no pre-factors, so the exponentials are
+ * interpolated in the pre-factor table with each FSR's sigma_t
+ * @param groups the energy groups to sweep
+ * @param num_groups the number of energy groups in the list
+ */
+void Solver::sweepSharedSegments(int* groups, int num_groups) {
+
+	Track* track;
+	int num_segments;
+	const shared_segment* segments;
+	const shared_segment* seg;
+	double* weights;
+	double* polar_fluxes;
+	double* sigma_t;
+	FlatSourceRegion* fsr;
+	double fsr_flux[NUM_ENERGY_GROUPS];
+	double delta;
+	double sigma_t_l;
+	int t, j, k, s, d, p, g, e, pe, fsr_id, index;
+	int num_threads = _num_azim / 2;
 
+	/* Each thread sweeps a pair of reflecting azimuthal angles as in
+	 * sweepTrackSegments */
+	#if USE_OPENMP
+	#pragma omp parallel for num_threads(num_threads) \
+			private(t, k, j, s, d, p, g, e, pe, track, segments, seg, \
+					num_segments, weights, polar_fluxes, sigma_t, \
+					fsr, fsr_id, delta, fsr_flux, sigma_t_l, index)
+	#endif
+	for (t = 0; t < num_threads; t++) {
 
-				/* Transfer flux to outgoing track */
-				track->getTrackOut()->setPolarFluxes(track->isReflOut(),
-													0, polar_fluxes);
+		j = t;
+		while (j < _num_azim) {
 
-				/* Loop over each segment in reverse direction */
-				for (s = num_segments-1; s > -1; s--) {
-					segment = segments.at(s);
-					fsr = &_flat_source_regions[segment->_region_id];
-					ratios = fsr->getRatios();
+		for (k = 0; k < _num_tracks[j]; k++) {
 
-					/* Zero out temporary FSR flux array */
-					for (e = 0; e < NUM_ENERGY_GROUPS; e++)
-						fsr_flux[e] = 0.0;
+			track = &_tracks[j][k];
+			segments = _segment_database->getSegments(j, k);
+			num_segments = _segment_database->getNumSegments(j, k);
+			weights = track->getPolarWeights();
+			polar_fluxes = track->getPolarFluxes();
 
-					/* Initialize the polar angle and energy group counter */
-					pe = GRP_TIMES_ANG;
+			/* Sweep the segments forward and then in reverse */
+			for (d = 0; d < 2; d++) {
+				for (s = 0; s < num_segments; s++) {
+					seg = &segments[d == 0 ? s : num_segments - s - 1];
+					fsr_id = seg->_region_id;
+					fsr = &_flat_source_regions[fsr_id];
+					sigma_t = fsr->getMaterial()->getSigmaT();
 
-#if !STORE_PREFACTORS
-					sigma_t = segment->_material->getSigmaT();
+					for (e = 0; e < NUM_ENERGY_GROUPS; e++)
+						fsr_flux[e] = 0.0;
 
-					for (e = 0; e < NUM_ENERGY_GROUPS; e++) {
+					for (g = 0; g < num_groups; g++) {
+						e = groups[g];
+						pe = d * GRP_TIMES_ANG + e * NUM_POLAR_ANGLES;
 
-						fsr_flux[e] = 0;
-						sigma_t_l = sigma_t[e] * segment->_length;
-						sigma_t_l = std::min(sigma_t_l,10.0);
+						sigma_t_l = std::min(sigma_t[e] * seg->_length, 10.0);
 						index = sigma_t_l / _pre_factor_spacing;
 						index = std::min(index * 2 * NUM_POLAR_ANGLES,
 												_pre_factor_max_index);
 
-						for (p = 0; p < NUM_POLAR_ANGLES; p++){
-							delta = (polar_fluxes[pe] - ratios[e]) *
-							(1 - (_pre_factor_array[index + 2 * p] * sigma_t_l
-							+ _pre_factor_array[index + 2 * p + 1]));
-							fsr_flux[e] += delta * weights[p];
-							polar_fluxes[pe] -= delta;
-							pe++;
-						}
-					}
-
-#else
-					/* Loop over all polar angles and energy groups */
-					for (e = 0; e < NUM_ENERGY_GROUPS; e++) {
 						for (p = 0; p < NUM_POLAR_ANGLES; p++) {
-							delta = (polar_fluxes[pe] - ratios[e]) *
-											segment->_prefactors[e][p];
+							delta = (polar_fluxes[pe] -
+									_ratios[FSR_INDEX(fsr_id, e)]) *
+									(1 - (_pre_factor_array[index + 2 * p] *
+									sigma_t_l + _pre_factor_array[index +
+									2 * p + 1]));
 							fsr_flux[e] += delta * weights[p];
 							polar_fluxes[pe] -= delta;
 							pe++;
 						}
 					}
-#endif
-
-#if CMFD_ACCEL
-					if (cmfd == true){
-
-						if (segment->_mesh_surface_bwd != NULL){
-							pe = 0;
-
-							for (e = 0; e < NUM_ENERGY_GROUPS; e++) {
-								for (p = 0; p < NUM_POLAR_ANGLES; p++){
-									/* increment current (polar and azimuthal weighted flux, group)*/
-									segment->_mesh_surface_bwd->incrementCurrent(polar_fluxes[pe] * weights[p], track->getPhi(), e);
-									segment->_mesh_surface_bwd->incrementFlux(polar_fluxes[pe] * weights[p], e);
-									pe++;
-								}
-							}
-						}
-					}
-#endif
 
-					/* Increment the scalar flux for this FSR */
 					fsr->incrementFlux(fsr_flux);
 				}
 
-				/* Transfer flux to incoming track */
-				track->getTrackIn()->setPolarFluxes(track->isReflIn(),
-										GRP_TIMES_ANG, polar_fluxes);
-			}
-
-			/* Update the azimuthal angle index for this thread
-			 * such that the next azimuthal angle is the one that reflects
-			 * out of the current one. If instead this is the 2nd (final)
-			 * angle to be used by this thread, break loop */
-			if (j < num_threads)
-				j = _num_azim - j - 1;
-			else
-				break;
-
+				/* Transfer flux to the outgoing or incoming track */
+				if (d == 0)
+					track->getTrackOut()->setPolarFluxes(track->isReflOut(),
+									0, polar_fluxes, groups, num_groups);
+				else
+					track->getTrackIn()->setPolarFluxes(track->isReflIn(),
+						GRP_TIMES_ANG, polar_fluxes, groups, num_groups);
 			}
 		}
 
+		if (j < num_threads)
+			j = _num_azim - j - 1;
+		else
+			break;
 
-		/* Add in source term and normalize flux to volume for each region */
-		/* Loop over flat source regions, energy groups */
-		#if USE_OPENMP
-		#pragma omp parallel for private(fsr, scalar_flux, ratios, \
-													sigma_t, volume)
-		#endif
-		for (int r = 0; r < _num_FSRs; r++) {
-			fsr = &_flat_source_regions[r];
-			scalar_flux = fsr->getFlux();
-			ratios = fsr->getRatios();
-			sigma_t = fsr->getMaterial()->getSigmaT();
-			volume = fsr->getVolume();
-
-			for (int e = 0; e < NUM_ENERGY_GROUPS; e++) {
-				fsr->setFlux(e, scalar_flux[e] / 2.0);
-				fsr->setFlux(e, FOUR_PI * ratios[e] + (scalar_flux[e] /
-												(sigma_t[e] * volume)));
-			}
 		}
+	}
+}
 
 
-		/* Check for convergence if max_iterations > 1 */
-		if (max_iterations > 1) {
-			bool converged = true;
-			#if USE_OPENMP
-			#pragma omp parallel for private(fsr, scalar_flux, old_scalar_flux) shared(converged)
-			#endif
-			for (int r = 0; r < _num_FSRs; r++) {
-				fsr = &_flat_source_regions[r];
-				scalar_flux = fsr->getFlux();
-				old_scalar_flux = fsr->getOldFlux();
+/**
+ * Performs one transport sweep over all tracks for a list of energy groups
+ * using the current source / sigma_t ratios in each FSR. The scalar fluxes
+ * for the energy groups in the list are recomputed from scratch while
+ * those for the remaining energy groups are left unchanged
+ * @param groups the energy groups to sweep
+ * @param num_groups the number of energy groups in the list
+ * @param cmfd whether or not to tally the mesh surface currents
+ * @param group_residuals if not NULL, set to the largest relative change
+ *        in the scalar flux for each energy group in the list
+ * @return the largest relative change in the scalar flux
+ */
+double Solver::transportSweep(int* groups, int num_groups, bool cmfd,
+										double* group_residuals) {
 
-				for (int e = 0; e < NUM_ENERGY_GROUPS; e++) {
-					if (fabs((scalar_flux[e] - old_scalar_flux[e]) /
-							old_scalar_flux[e]) > FLUX_CONVERGENCE_THRESH )
-						converged = false;
+	double* sigma_t;
+	FlatSourceRegion* fsr;
+	double volume;
+	double new_flux;
+	double residual = 0.0;
+	double residuals[NUM_ENERGY_GROUPS];
+	double thread_residuals[NUM_ENERGY_GROUPS];
+	int e, i;
+
+	/* Initialize flux in each region to zero for this list of groups */
+	#if USE_OPENMP
+	#pragma omp parallel for
+	#endif
+	for (int r = 0; r < _num_FSRs; r++) {
+		for (int g = 0; g < num_groups; g++)
+			_scalar_flux[FSR_INDEX(r, groups[g])] = 0.0;
+	}
 
-					/* Update old scalar flux */
-					old_scalar_flux[e] = scalar_flux[e];
+#if CMFD_ACCEL
+	if (cmfd == true){
+
+		/* zero surface currents for this list of groups */
+		Mesh* mesh = _geom->getMesh();
+		for (int cell = 0; cell < mesh->getCellHeight()*mesh->getCellWidth(); cell++){
+			for (int surface = 0; surface < 8; surface++){
+				for (int g = 0; g < num_groups; g++){
+					mesh->getCells(cell)->getMeshSurfaces(surface)->setCurrent(0, groups[g]);
+					mesh->getCells(cell)->getMeshSurfaces(surface)->setFlux(0, groups[g]);
 				}
 			}
-
-			if (converged)
-				return;
-		}
-
-		/* Update the old scalar flux for each region, energy group */
-		#if USE_OPENMP
-		#pragma omp parallel for private(fsr, scalar_flux, old_scalar_flux)
-		#endif
-		for (int r = 0; r < _num_FSRs; r++) {
-			fsr = &_flat_source_regions[r];
-			scalar_flux = fsr->getFlux();
-			old_scalar_flux = fsr->getOldFlux();
-
-			/* Update old scalar flux */
-			for (int e = 0; e < NUM_ENERGY_GROUPS; e++)
-				old_scalar_flux[e] = scalar_flux[e];
 		}
 	}
+#endif
 
-	if (max_iterations > 1)
-		log_printf(WARNING, "Scalar flux did not converge after %d iterations",
-															max_iterations);
+	if (_segment_database != NULL)
+		sweepSharedSegments(groups, num_groups);
+	else if (_track_generator->getNumTiles() > 1)
+		sweepTiles(groups, num_groups, cmfd);
+	else if (_track_generator->getNumChains() > 0)
+		sweepChains(groups, num_groups, cmfd);
+	else
+		sweepTrackSegments(groups, num_groups, cmfd);
 
-	return;
-}
+	/* Pass the fluxes which left each tile to the neighbouring tiles */
+	_track_generator->passTileFluxes(groups, num_groups);
 
+#if USE_MPI
+	/* Add up the flux tallies of the FSRs in all subdomains and pass the
+	 * angular fluxes leaving this subdomain to the neighbouring ones */
+	if (_domain != NULL) {
+		std::vector<double> tallies(_num_FSRs * num_groups);
 
-double Solver::computeKeff(int max_iterations) {
+		for (int r = 0; r < _num_FSRs; r++) {
+			for (int g = 0; g < num_groups; g++)
+				tallies[r * num_groups + g] =
+								_scalar_flux[FSR_INDEX(r, groups[g])];
+		}
 
-	double scatter_source, fission_source;
-	double renorm_factor, volume;
-	double* nu_sigma_f;
-	double* sigma_s;
-	double* chi;
-	double* scalar_flux;
-	double* source;
-	double* old_source;
-	FlatSourceRegion* fsr;
-	Material* material;
-	int start_index, end_index;
+		_domain->sum(&tallies[0], _num_FSRs * num_groups);
 
+		for (int r = 0; r < _num_FSRs; r++) {
+			for (int g = 0; g < num_groups; g++)
+				_scalar_flux[FSR_INDEX(r, groups[g])] =
+								tallies[r * num_groups + g];
+		}
 
-	log_printf(NORMAL, "Computing k_eff...");
+		_domain->exchangeBoundaryFluxes();
+	}
+#endif
 
-	/* Check that each FSR has at least one segment crossing it */
-	checkTrackSpacing();
+	/* Add in source term and normalize flux to volume for each region,
+	 * find the largest relative change in the scalar flux of each group and
+	 * update the old scalar flux in a single pass */
+	for (int g = 0; g < num_groups; g++)
+		residuals[groups[g]] = 0.0;
 
-	/* Initial guess */
-	_old_k_effs.push(1.0);
+	#if USE_OPENMP
+	#pragma omp parallel private(fsr, sigma_t, volume, new_flux, i, e, \
+			thread_residuals)
+	{
+	#endif
 
-	/* Set scalar flux to unity for each region */
-	oneFSRFluxes();
-	zeroTrackFluxes();
+	for (int g = 0; g < num_groups; g++)
+		thread_residuals[groups[g]] = 0.0;
 
-	/* Set the old source to unity for each Region */
 	#if USE_OPENMP
-	#pragma omp parallel for private(fsr)
+	#pragma omp for
 	#endif
 	for (int r = 0; r < _num_FSRs; r++) {
 		fsr = &_flat_source_regions[r];
+		sigma_t = fsr->getMaterial()->getSigmaT();
+		volume = fsr->getVolume();
 
-		for (int e = 0; e < NUM_ENERGY_GROUPS; e++)
-			fsr->setOldSource(e, 1.0);
+		for (int g = 0; g < num_groups; g++) {
+			e = groups[g];
+			i = FSR_INDEX(r, e);
+			new_flux = FOUR_PI * _ratios[i] + (0.5 * _scalar_flux[i] /
+											(sigma_t[e] * volume));
+			thread_residuals[e] = std::max(thread_residuals[e],
+						fabs((new_flux - _old_scalar_flux[i]) /
+												_old_scalar_flux[i]));
+			_scalar_flux[i] = new_flux;
+			_old_scalar_flux[i] = new_flux;
+		}
 	}
 
-	// Source iteration loop
-	for (int i = 0; i < max_iterations; i++) {
+	#if USE_OPENMP
+	#pragma omp critical
+	#endif
+	for (int g = 0; g < num_groups; g++)
+		residuals[groups[g]] = std::max(residuals[groups[g]],
+										thread_residuals[groups[g]]);
 
-		log_printf(NORMAL, "Iteration %d: k_eff = %f", i, _k_eff);
+	#if USE_OPENMP
+	}
+	#endif
 
-		/*********************************************************************
-		 * Renormalize scalar and boundary fluxes
-		 *********************************************************************/
+	for (int g = 0; g < num_groups; g++) {
+		residual = std::max(residual, residuals[groups[g]]);
+		if (group_residuals != NULL)
+			group_residuals[groups[g]] = residuals[groups[g]];
+	}
 
-		/* Initialize fission source to zero */
-		fission_source = 0;
+	return residual;
+}
 
-		/* Compute total fission source to zero for this region */
-		for (int r = 0; r < _num_FSRs; r++) {
 
-			/* Get pointers to important data structures */
-			fsr = &_flat_source_regions[r];
-			material = fsr->getMaterial();
-			nu_sigma_f = material->getNuSigmaF();
-			scalar_flux = fsr->getFlux();
-			volume = fsr->getVolume();
+/**
+ * Sweeps all tracks for a contiguous range of energy groups
+ * @param group_start the first energy group
+ * @param group_end one past the last energy group
+ * @param cmfd whether to tally the surface currents on the CMFD mesh
+ * @return the largest relative change in the scalar flux
+ */
+double Solver::transportSweep(int group_start, int group_end, bool cmfd) {
 
-			start_index = fsr->getMaterial()->getNuSigmaFStart();
-			end_index = fsr->getMaterial()->getNuSigmaFEnd();
+	int groups[NUM_ENERGY_GROUPS];
 
-			for (int e = start_index; e < end_index; e++)
-				fission_source += nu_sigma_f[e] * scalar_flux[e] * volume;
-		}
+	for (int e = group_start; e < group_end; e++)
+		groups[e - group_start] = e;
 
-		/* Renormalize scalar fluxes in each region */
-		renorm_factor = 1.0 / fission_source;
+	return transportSweep(groups, group_end - group_start, cmfd, NULL);
+}
 
-		#if USE_OPENMP
+
+/**
+ * Writes k_eff and the scalar flux of each energy group in each FSR to a
+ * text file, one FSR per line
+ * @param output_file the path of the flux file
+ * @return whether or not the file could be written
+ */
+bool Solver::writeScalarFluxes(const char* output_file) {
+
+	FILE* file = fopen(output_file, "w");
+
+	if (file == NULL) {
+		log_printf(WARNING, "Unable to open flux file %s for writing",
+															output_file);
+		return false;
+	}
+
+	fprintf(file, "# k_eff = %.8f\n", _k_eff);
+	fprintf(file, "# FSR id, material id, scalar flux in each group\n");
+
+	/* Write the FSRs in their original order */
+	int i;
+
+	for (int r = 0; r < _num_FSRs; r++) {
+		i = _geom->getInternalFSRId(r);
+		fprintf(file, "%d %d", r,
+							_flat_source_regions[i].getMaterial()->getId());
+
+		for (int e = 0; e < NUM_ENERGY_GROUPS; e++)
+			fprintf(file, " %.8e", _scalar_flux[FSR_INDEX(i, e)]);
+
+		fprintf(file, "\n");
+	}
+
+	fclose(file);
+
+	return true;
+}
+
+
+/**
+ * Compute the fission rates in each FSR and save them in a map of
+ * FSR ids to fission rates
+ */
+void Solver::computePinPowers() {
+
+	log_printf(NORMAL, "Computing pin powers...");
+
+	FlatSourceRegion* fsr;
+	double tot_pin_power = 0;
+	double avg_pin_power = 0;
+	double num_nonzero_pins = 0;
+	double curr_pin_power = 0;
+	double prev_pin_power = 0;
+
+	/* create BitMaps for plotting */
+	BitMap<int>* bitMapFSR = new BitMap<int>;
+	BitMap<float>* bitMap = new BitMap<float>;
+	bitMapFSR->pixel_x = _plotter->getBitLengthX();
+	bitMapFSR->pixel_y = _plotter->getBitLengthY();
+	bitMap->pixel_x = _plotter->getBitLengthX();
+	bitMap->pixel_y = _plotter->getBitLengthY();
+	initialize(bitMapFSR);
+	initialize(bitMap);
+	bitMap->geom_x = _geom->getWidth();
+	bitMap->geom_y = _geom->getHeight();
+	bitMapFSR->color_type = RANDOM;
+	bitMap->color_type = SCALED;
+
+	/* make FSR BitMap */
+	_plotter->makeFSRMap(bitMapFSR->pixels);
+
+	/* Loop over all FSRs and compute the fission rate*/
+	for (int i=0; i < _num_FSRs; i++) {
+		fsr = &_flat_source_regions[_geom->getInternalFSRId(i)];
+		_FSRs_to_powers[i] = fsr->computeFissionRate();
+	}
+
+	/* Compute the pin powers by adding up the powers of FSRs in each
+	 * lattice cell, saving lattice cell powers to files, and saving the
+	 * pin power corresponding to each FSR id in FSR_to_pin_powers */
+	_geom->computePinPowers(_FSRs_to_powers, _FSRs_to_pin_powers);
+
+
+	/* Compute the total power based by accumulating the power of each unique
+	 * pin with a nonzero power */
+	for (int i=0; i < _num_FSRs; i++) {
+		curr_pin_power = _FSRs_to_pin_powers[i];
+
+		/* If this pin power is unique and nozero (doesn't match the previous
+		 * pin's power), then tally it
+		 */
+		if (curr_pin_power > 0 && curr_pin_power != prev_pin_power) {
+			tot_pin_power += curr_pin_power;
+			num_nonzero_pins++;
+			prev_pin_power = curr_pin_power;
+		}
+	}
+
+	/* Compute the average pin power */
+	avg_pin_power = tot_pin_power / num_nonzero_pins;
+
+	/* Normalize each pin power to the average non-zero pin power */
+	for (int i=0; i < _num_FSRs; i++) {
+		_FSRs_to_pin_powers[i] /= avg_pin_power;
+	}
+
+
+	log_printf(NORMAL, "Plotting pin powers...");
+	_plotter->makeRegionMap(bitMapFSR->pixels, bitMap->pixels, _FSRs_to_pin_powers);
+	plot(bitMap, "pin_powers", _plotter->getExtension());
+
+	/* delete bitMaps */
+	deleteBitMap(bitMapFSR);
+	deleteBitMap(bitMap);
+
+	return;
+}
+
+
+
+/**
+ * Sweeps all energy groups with a fixed source until the scalar flux
+ * converges to the flux tolerance, or FLUX_CONVERGENCE_THRESH if none has
+ * been set, or max_iterations is reached. If skipping of converged groups
+ * is enabled, each group is dropped from the sweeps once its own scalar
+ * flux has converged
+ * @param max_iterations the maximum number of sweeps
+ * @param cmfd whether or not to tally the mesh surface currents
+ * @return the largest relative change in the scalar flux in the last sweep
+ */
+double Solver::fixedSourceIteration(int max_iterations, bool cmfd = false) {
+
+	double residual = 0.0;
+	double group_residuals[NUM_ENERGY_GROUPS];
+	int groups[NUM_ENERGY_GROUPS];
+	int num_groups = NUM_ENERGY_GROUPS;
+	int num_active;
+	int num_threads = _num_azim / 2;
+	double flux_tolerance = (_flux_tolerance > 0.0) ?
+								_flux_tolerance : FLUX_CONVERGENCE_THRESH;
+
+	log_printf(INFO, "Fixed source iteration with max_iterations = %d and "
+			"# threads = %d", max_iterations, num_threads);
+
+	for (int e = 0; e < NUM_ENERGY_GROUPS; e++)
+		groups[e] = e;
+
+	/* Loop for until converged or max_iterations is reached */
+	for (int i = 0; i < max_iterations; i++) {
+
+		/* Sweep all tracks for all active energy groups */
+		residual = transportSweep(groups, num_groups, cmfd, group_residuals);
+
+		/* Check for convergence if max_iterations > 1 */
+		if (max_iterations > 1 && residual <= flux_tolerance)
+			return residual;
+
+		/* The source is fixed, so the energy groups are decoupled and a
+		 * converged group can be dropped from the remaining sweeps */
+		if (_skip_converged_groups && max_iterations > 1) {
+			num_active = 0;
+
+			for (int g = 0; g < num_groups; g++) {
+				if (group_residuals[groups[g]] > flux_tolerance)
+					groups[num_active++] = groups[g];
+				else
+					log_printf(INFO, "Energy group %d converged after %d "
+							"sweeps", groups[g], i + 1);
+			}
+
+			num_groups = num_active;
+		}
+	}
+
+	if (max_iterations > 1)
+		log_printf(WARNING, "Scalar flux did not converge after %d iterations",
+															max_iterations);
+
+	return residual;
+}
+
+
+/**
+ * Updates each FSR for a new source iteration in a single parallel pass.
+ * The scalar fluxes are renormalized, the previous source is saved as the
+ * old source, and the fission source, total source and source / sigma_t
+ * ratios are recomputed from the normalized fluxes
+ * @param renorm_factor the factor to renormalize the scalar fluxes by
+ */
+void Solver::updateSources(double renorm_factor) {
+
+	double fission_source, scatter_source;
+	double flux[NUM_ENERGY_GROUPS];
+	double fission_spectrum[NUM_ENERGY_GROUPS];
+	double* nu_sigma_f;
+	double* sigma_s_values;
+	int* sigma_s_columns;
+	int* sigma_s_row_offsets;
+	double* sigma_t;
+	double* chi;
+	Material* material;
+	int r, start_index, end_index;
+	double inverse_k = 1.0 / _old_k_effs.front();
+
+	/* Loop over the FSRs one material at a time */
+	for (int b = 0; b < _num_material_buckets; b++) {
+		material = _material_buckets[b];
+		nu_sigma_f = material->getNuSigmaF();
+		sigma_s_values = material->getSigmaSValues();
+		sigma_s_columns = material->getSigmaSColumns();
+		sigma_s_row_offsets = material->getSigmaSRowOffsets();
+		sigma_t = material->getSigmaT();
+		chi = material->getChi();
+		start_index = material->getNuSigmaFStart();
+		end_index = material->getNuSigmaFEnd();
+
+		/* The fission source is the rank one term chi nu_sigma_f^T / k,
+		 * applied as a dot product and a scaled copy of chi. Non-fissile
+		 * materials have an empty nu_sigma_f range and skip it */
+		for (int G = 0; G < NUM_ENERGY_GROUPS; G++)
+			fission_spectrum[G] = inverse_k * chi[G];
+
+		#if USE_OPENMP
+		#pragma omp parallel for private(r, flux, fission_source, \
+				scatter_source)
+		#endif
+		for (int i = _material_bucket_offsets[b];
+							i < _material_bucket_offsets[b+1]; i++) {
+			r = _material_bucket_FSRs[i];
+
+			/* Renormalize the region's scalar flux */
+			for (int e = 0; e < NUM_ENERGY_GROUPS; e++) {
+				_scalar_flux[FSR_INDEX(r, e)] *= renorm_factor;
+				flux[e] = _scalar_flux[FSR_INDEX(r, e)];
+			}
+
+			/* Compute total fission source for current region */
+			fission_source = 0;
+			for (int e = start_index; e < end_index; e++)
+				fission_source += flux[e] * nu_sigma_f[e];
+
+			_FSRs_to_fission_source[r] = fission_source;
+
+			/* Compute the scattering source over the nonzero elements of
+			 * each row, save the previous source and set the new source */
+			for (int G = 0; G < NUM_ENERGY_GROUPS; G++) {
+				scatter_source = 0;
+
+				for (int k = sigma_s_row_offsets[G];
+									k < sigma_s_row_offsets[G+1]; k++)
+					scatter_source += sigma_s_values[k]
+					                          * flux[sigma_s_columns[k]];
+
+				_old_source[FSR_INDEX(r, G)] = _source[FSR_INDEX(r, G)];
+				_source[FSR_INDEX(r, G)] = (fission_spectrum[G] *
+						fission_source + scatter_source) * ONE_OVER_FOUR_PI;
+				_ratios[FSR_INDEX(r, G)] = _source[FSR_INDEX(r, G)] /
+																sigma_t[G];
+			}
+		}
+	}
+
+	return;
+}
+
+
+/**
+ * Finds the first energy group which receives upscattering from a higher
+ * energy group in any FSR's material. All energy groups from this group
+ * onward form the upscatter block
+ * @return the first energy group in the upscatter block
+ */
+int Solver::computeUpscatterStart() {
+
+	Material* material;
+	int upscatter_start = NUM_ENERGY_GROUPS;
+
+	for (int r = 0; r < _num_FSRs; r++) {
+		material = _flat_source_regions[r].getMaterial();
+
+		for (int G = 0; G < upscatter_start; G++) {
+			if (material->getSigmaSEnd(G) > G + 1) {
+				upscatter_start = G;
+				break;
+			}
+		}
+	}
+
+	return upscatter_start;
+}
+
+
+/**
+ * Computes the total source and the source / sigma_t ratios for a range of
+ * energy groups in each FSR from the current scalar fluxes and the fission
+ * source computed at the start of the source iteration
+ * @param group_start the first energy group
+ * @param group_end one past the last energy group
+ */
+void Solver::computeGroupSources(int group_start, int group_end) {
+
+	double scatter_source;
+	double* sigma_s_values;
+	int* sigma_s_columns;
+	int* sigma_s_row_offsets;
+	double* sigma_t;
+	double* chi;
+	FlatSourceRegion* fsr;
+	Material* material;
+	double inverse_k = 1.0 / _old_k_effs.front();
+
+	#if USE_OPENMP
+	#pragma omp parallel for private(fsr, material, sigma_s_values, \
+				sigma_s_columns, sigma_s_row_offsets, sigma_t, chi, \
+				scatter_source)
+	#endif
+	for (int r = 0; r < _num_FSRs; r++) {
+		fsr = &_flat_source_regions[r];
+		material = fsr->getMaterial();
+		sigma_s_values = material->getSigmaSValues();
+		sigma_s_columns = material->getSigmaSColumns();
+		sigma_s_row_offsets = material->getSigmaSRowOffsets();
+		sigma_t = material->getSigmaT();
+		chi = material->getChi();
+
+		for (int G = group_start; G < group_end; G++) {
+			scatter_source = 0;
+
+			for (int k = sigma_s_row_offsets[G];
+								k < sigma_s_row_offsets[G+1]; k++)
+				scatter_source += sigma_s_values[k] *
+						_scalar_flux[FSR_INDEX(r, sigma_s_columns[k])];
+
+			_source[FSR_INDEX(r, G)] = (inverse_k * _FSRs_to_fission_source[r]
+							* chi[G] + scatter_source) * ONE_OVER_FOUR_PI;
+			_ratios[FSR_INDEX(r, G)] = _source[FSR_INDEX(r, G)] / sigma_t[G];
+		}
+	}
+
+	return;
+}
+
+
+/**
+ * Performs one Gauss-Seidel iteration in energy for a fixed fission source.
+ * The groups without upscattering are swept one at a time from fast to
+ * thermal, each with a scattering source which uses the freshly updated
+ * fluxes of the faster groups. The upscatter block is then swept group by
+ * group for the set number of upscatter sub-iterations
+ * @param upscatter_start the first energy group in the upscatter block
+ * @return the largest relative change in the scalar flux in any group sweep
+ */
+double Solver::energyGaussSeidelSweep(int upscatter_start) {
+
+	double residual = 0.0;
+
+	/* Downscatter only groups are converged in a single pass */
+	for (int G = 0; G < upscatter_start; G++) {
+		computeGroupSources(G, G + 1);
+		residual = std::max(residual, transportSweep(G, G + 1, CMFD_ACCEL));
+	}
+
+	/* Thermal upscatter sub-iterations */
+	for (int i = 0; i < _num_upscatter_iterations; i++) {
+		for (int G = upscatter_start; G < NUM_ENERGY_GROUPS; G++) {
+			computeGroupSources(G, G + 1);
+			residual = std::max(residual,
+								transportSweep(G, G + 1, CMFD_ACCEL));
+		}
+	}
+
+	return residual;
+}
+
+
+/**
+ * Sets whether or not to use Gauss-Seidel iteration in energy rather than
+ * sweeping all energy groups at once in computeKeff
+ * @param energy_gauss_seidel whether or not to use Gauss-Seidel in energy
+ */
+void Solver::setEnergyGaussSeidel(bool energy_gauss_seidel) {
+	_energy_gauss_seidel = energy_gauss_seidel;
+}
+
+
+/**
+ * Sets the number of sub-iterations over the upscatter block of energy
+ * groups for each source iteration in Gauss-Seidel energy mode
+ * @param num_upscatter_iterations the number of upscatter sub-iterations
+ */
+void Solver::setNumUpscatterIterations(int num_upscatter_iterations) {
+
+	if (num_upscatter_iterations < 1)
+		log_printf(ERROR, "Unable to set the number of upscatter iterations "
+				"to %d since it must be at least 1", num_upscatter_iterations);
+
+	_num_upscatter_iterations = num_upscatter_iterations;
+}
+
+
+/**
+ * Sets whether or not fixed source iterations with more than one sweep
+ * drop each energy group from the sweeps once its scalar flux converges
+ * @param skip_converged_groups whether or not to skip converged groups
+ */
+void Solver::setSkipConvergedGroups(bool skip_converged_groups) {
+	_skip_converged_groups = skip_converged_groups;
+}
+
+
+/**
+ * Sets the tolerance on the change in k_eff between source iterations
+ * @param keff_tolerance the k_eff tolerance
+ */
+void Solver::setKeffTolerance(double keff_tolerance) {
+
+	if (keff_tolerance <= 0.0)
+		log_printf(ERROR, "Unable to set the k_eff tolerance to %f since it "
+				"must be positive", keff_tolerance);
+
+	_keff_tolerance = keff_tolerance;
+}
+
+
+/**
+ * Sets the tolerance on the relative change in the fission source
+ * distribution between source iterations. A tolerance of zero turns off
+ * this stopping criterion
+ * @param source_tolerance the fission source tolerance
+ * @param source_norm the norm over the FSRs of the relative change
+ */
+void Solver::setSourceTolerance(double source_tolerance,
+										residualNorm source_norm) {
+	_source_tolerance = source_tolerance;
+	_source_norm = source_norm;
+}
+
+
+/**
+ * Sets the tolerance on the largest relative change in the scalar flux
+ * in the sweep of each source iteration. This also replaces
+ * FLUX_CONVERGENCE_THRESH for fixed source iterations with more than one
+ * sweep. A tolerance of zero turns off this stopping criterion
+ * @param flux_tolerance the scalar flux tolerance
+ */
+void Solver::setFluxTolerance(double flux_tolerance) {
+	_flux_tolerance = flux_tolerance;
+}
+
+
+/**
+ * Sets the binary file to which the solver state is saved every
+ * checkpoint_interval source iterations and when computeKeff returns
+ * @param checkpoint_file the checkpoint file name
+ * @param checkpoint_interval the number of source iterations between
+ *        checkpoints, or 0 to only save the final state
+ */
+void Solver::setCheckpointFile(std::string checkpoint_file,
+											int checkpoint_interval) {
+
+	if (checkpoint_interval < 0)
+		log_printf(ERROR, "Unable to set the checkpoint interval to %d since "
+				"it must not be negative", checkpoint_interval);
+
+	_checkpoint_file = checkpoint_file;
+	_checkpoint_interval = checkpoint_interval;
+}
+
+
+/**
+ * Sets a checkpoint file from which computeKeff restores the solver state
+ * before the first source iteration
+ * @param restart_file the checkpoint file name
+ */
+void Solver::setRestartFile(std::string restart_file) {
+	_restart_file = restart_file;
+}
+
+
+/**
+ * Sets whether or not computeKeff starts from the fluxes and k_eff of the
+ * previous call rather than from a flat flux, e.g. for a sequence of
+ * perturbed material sets in the same geometry
+ * @param warm_start whether or not to warm start each solve
+ */
+void Solver::setWarmStart(bool warm_start) {
+	_warm_start = warm_start;
+}
+
+
+/**
+ * Returns the number of source iterations of the last call to computeKeff
+ * @return the number of source iterations
+ */
+int Solver::getNumIterations() {
+	return _num_iterations;
+}
+
+
+/**
+ * Writes the FSR scalar fluxes, sources and old sources, the track boundary
+ * angular fluxes, the k_eff history and the iteration count to the binary
+ * checkpoint file. The state is written to a temporary file which then
+ * replaces the checkpoint, so an interrupted write leaves the previous one
+ * @param iteration the number of the next source iteration
+ */
+void Solver::writeCheckpoint(int iteration) {
+
+	std::string temp_file = _checkpoint_file + ".tmp";
+	std::queue<double> k_effs = _old_k_effs;
+	int num_k_effs = k_effs.size();
+	int num_groups = NUM_ENERGY_GROUPS;
+	int material_id;
+	int i;
+	double value;
+
+	FILE* file = fopen(temp_file.c_str(), "wb");
+
+	if (file == NULL) {
+		log_printf(WARNING, "Unable to open checkpoint file %s for writing",
+														temp_file.c_str());
+		return;
+	}
+
+	fwrite(CHECKPOINT_ID, sizeof(char), sizeof(CHECKPOINT_ID), file);
+	fwrite(&_num_FSRs, sizeof(int), 1, file);
+	fwrite(&num_groups, sizeof(int), 1, file);
+	fwrite(&_num_polar_fluxes, sizeof(int), 1, file);
+	fwrite(&iteration, sizeof(int), 1, file);
+	fwrite(&_k_eff, sizeof(double), 1, file);
+	fwrite(&num_k_effs, sizeof(int), 1, file);
+
+	while (!k_effs.empty()) {
+		value = k_effs.front();
+		fwrite(&value, sizeof(double), 1, file);
+		k_effs.pop();
+	}
+
+	/* The FSR arrays are written FSR-major in the original FSR order
+	 * whatever the storage layout and numbering */
+	for (int r = 0; r < _num_FSRs; r++) {
+		i = _geom->getInternalFSRId(r);
+		material_id = _flat_source_regions[i].getMaterial()->getId();
+		fwrite(&material_id, sizeof(int), 1, file);
+
+		for (int e = 0; e < NUM_ENERGY_GROUPS; e++) {
+			fwrite(&_scalar_flux[FSR_INDEX(i, e)], sizeof(double), 1, file);
+			fwrite(&_source[FSR_INDEX(i, e)], sizeof(double), 1, file);
+			fwrite(&_old_source[FSR_INDEX(i, e)], sizeof(double), 1, file);
+		}
+	}
+
+	for (int i = 0; i < _num_azim; i++) {
+		for (int j = 0; j < _num_tracks[i]; j++)
+			fwrite(_tracks[i][j].getPolarFluxes(), sizeof(double),
+												2 * GRP_TIMES_ANG, file);
+	}
+
+	fclose(file);
+
+	if (rename(temp_file.c_str(), _checkpoint_file.c_str()) != 0)
+		log_printf(WARNING, "Unable to replace checkpoint file %s",
+											_checkpoint_file.c_str());
+	else
+		log_printf(INFO, "Wrote checkpoint for iteration %d to %s",
+									iteration, _checkpoint_file.c_str());
+
+	return;
+}
+
+
+/**
+ * Restores the solver state from the restart file. If the FSR and track
+ * counts and the FSR materials match the saved state, the k_eff history
+ * and iteration count are restored too and the run resumes where it
+ * stopped. If only the materials of some FSRs or the tracks changed, the
+ * saved FSR fluxes and k_eff are used as the initial guess instead and
+ * the boundary fluxes are kept if the track count still matches
+ * @return the source iteration to start from
+ */
+int Solver::readCheckpoint() {
+
+	char id[sizeof(CHECKPOINT_ID)];
+	int num_FSRs, num_groups, num_polar_fluxes, iteration, num_k_effs;
+	int material_id;
+	int num_changed = 0;
+	int i;
+	double k_eff;
+	double* k_effs;
+	double* polar_fluxes;
+	bool valid;
+
+	FILE* file = fopen(_restart_file.c_str(), "rb");
+
+	if (file == NULL) {
+		log_printf(WARNING, "Unable to open restart file %s; starting from "
+					"a flat flux", _restart_file.c_str());
+		return 0;
+	}
+
+	valid = fread(id, sizeof(char), sizeof(CHECKPOINT_ID), file) ==
+														sizeof(CHECKPOINT_ID)
+			&& memcmp(id, CHECKPOINT_ID, sizeof(CHECKPOINT_ID)) == 0
+			&& fread(&num_FSRs, sizeof(int), 1, file) == 1
+			&& fread(&num_groups, sizeof(int), 1, file) == 1
+			&& fread(&num_polar_fluxes, sizeof(int), 1, file) == 1
+			&& fread(&iteration, sizeof(int), 1, file) == 1
+			&& fread(&k_eff, sizeof(double), 1, file) == 1
+			&& fread(&num_k_effs, sizeof(int), 1, file) == 1;
+
+	if (!valid || num_FSRs != _num_FSRs || num_groups != NUM_ENERGY_GROUPS
+										|| num_k_effs > NUM_KEFFS_TRACKED) {
+		log_printf(WARNING, "Restart file %s is not a checkpoint of this "
+				"geometry's %d FSRs and %d energy groups; starting from a "
+				"flat flux", _restart_file.c_str(), _num_FSRs,
+				NUM_ENERGY_GROUPS);
+		fclose(file);
+		return 0;
+	}
+
+	k_effs = new double[num_k_effs];
+	valid = fread(k_effs, sizeof(double), num_k_effs, file) ==
+												(size_t)num_k_effs;
+
+	for (int r = 0; r < _num_FSRs && valid; r++) {
+		i = _geom->getInternalFSRId(r);
+		valid = fread(&material_id, sizeof(int), 1, file) == 1;
+
+		if (material_id != _flat_source_regions[i].getMaterial()->getId())
+			num_changed++;
+
+		for (int e = 0; e < NUM_ENERGY_GROUPS && valid; e++)
+			valid = fread(&_scalar_flux[FSR_INDEX(i, e)], sizeof(double), 1,
+															file) == 1
+				&& fread(&_source[FSR_INDEX(i, e)], sizeof(double), 1,
+															file) == 1
+				&& fread(&_old_source[FSR_INDEX(i, e)], sizeof(double), 1,
+															file) == 1;
+	}
+
+	if (!valid)
+		log_printf(ERROR, "Restart file %s is truncated",
+												_restart_file.c_str());
+
+	/* Keep the track boundary fluxes only if the tracks are unchanged */
+	if (num_polar_fluxes == _num_polar_fluxes) {
+		for (int i = 0; i < _num_azim; i++) {
+			for (int j = 0; j < _num_tracks[i]; j++) {
+				polar_fluxes = _tracks[i][j].getPolarFluxes();
+				if (fread(polar_fluxes, sizeof(double), 2 * GRP_TIMES_ANG,
+										file) != 2 * GRP_TIMES_ANG)
+					log_printf(ERROR, "Restart file %s is truncated",
+												_restart_file.c_str());
+			}
+		}
+	}
+
+	fclose(file);
+
+	_k_eff = k_eff;
+
+	if (num_changed == 0 && num_polar_fluxes == _num_polar_fluxes) {
+		while (!_old_k_effs.empty())
+			_old_k_effs.pop();
+		for (int i = 0; i < num_k_effs; i++)
+			_old_k_effs.push(k_effs[i]);
+
+		log_printf(NORMAL, "Resuming from iteration %d of restart file %s",
+									iteration, _restart_file.c_str());
+	}
+
+	else {
+		_old_k_effs.back() = k_eff;
+		iteration = 0;
+
+		log_printf(NORMAL, "Warm start from restart file %s with %d FSRs "
+				"with new materials and %s track fluxes", _restart_file.c_str(),
+				num_changed, (num_polar_fluxes == _num_polar_fluxes) ?
+				"saved" : "zero");
+	}
+
+	delete [] k_effs;
+
+	return iteration;
+}
+
+
+/**
+ * Computes the relative change in the normalized fission source in each
+ * fissile FSR since the previous call and saves the new distribution.
+ * The first call returns 1
+ * @return the L2 (root mean square) or L-infinity norm of the change
+ */
+double Solver::computeSourceResidual() {
+
+	double total_fission_source = 0.0;
+	double residual = 0.0;
+	double fission_source, relative_change;
+	double* nu_sigma_f;
+	int num_fissile = 0;
+	int r;
+
+	/* Find the total fission source to normalize the distribution */
+	for (int b = 0; b < _num_material_buckets; b++) {
+		nu_sigma_f = _material_buckets[b]->getNuSigmaF();
+
+		#if USE_OPENMP
+		#pragma omp parallel for private(r) \
+				reduction(+:total_fission_source)
+		#endif
+		for (int i = _material_bucket_offsets[b];
+							i < _material_bucket_offsets[b+1]; i++) {
+			r = _material_bucket_FSRs[i];
+			for (int e = _material_buckets[b]->getNuSigmaFStart();
+						e < _material_buckets[b]->getNuSigmaFEnd(); e++)
+				total_fission_source += nu_sigma_f[e] *
+						_scalar_flux[FSR_INDEX(r, e)] *
+						_flat_source_regions[r].getVolume();
+		}
+	}
+
+	/* Compare the normalized fission source in each region */
+	for (int b = 0; b < _num_material_buckets; b++) {
+		nu_sigma_f = _material_buckets[b]->getNuSigmaF();
+
+		for (int i = _material_bucket_offsets[b];
+							i < _material_bucket_offsets[b+1]; i++) {
+			r = _material_bucket_FSRs[i];
+			fission_source = 0.0;
+
+			for (int e = _material_buckets[b]->getNuSigmaFStart();
+						e < _material_buckets[b]->getNuSigmaFEnd(); e++)
+				fission_source += nu_sigma_f[e] *
+						_scalar_flux[FSR_INDEX(r, e)];
+
+			if (fission_source <= 0.0)
+				continue;
+
+			fission_source *= _flat_source_regions[r].getVolume() /
+													total_fission_source;
+			relative_change = fabs(fission_source -
+						_old_fission_source_dist[r]) / fission_source;
+			_old_fission_source_dist[r] = fission_source;
+			num_fissile++;
+
+			if (_source_norm == LINF_NORM)
+				residual = std::max(residual, relative_change);
+			else
+				residual += relative_change * relative_change;
+		}
+	}
+
+	if (_source_norm == L2_NORM && num_fissile > 0)
+		residual = sqrt(residual / num_fissile);
+
+	return residual;
+}
+
+
+double Solver::computeKeff(int max_iterations) {
+
+	double fission_source;
+	double renorm_factor, volume;
+	double source_residual = 0.0;
+	double flux_residual;
+	bool converged;
+	int start_iteration = 0;
+	double* nu_sigma_f;
+	int start_index, end_index;
+	int upscatter_start = NUM_ENERGY_GROUPS;
+
+#if FUSED_SOURCE_UPDATE
+	int r;
+#else
+	double scatter_source;
+	FlatSourceRegion* fsr;
+	double* sigma_s;
+	double* chi;
+	Material* material;
+#endif
+
+
+	log_printf(NORMAL, "Computing k_eff...");
+
+	/* Check that each FSR has at least one segment crossing it */
+	checkTrackSpacing();
+
+	/* Find the upscatter block for Gauss-Seidel iteration in energy */
+	if (_energy_gauss_seidel) {
+		upscatter_start = computeUpscatterStart();
+		log_printf(NORMAL, "Gauss-Seidel in energy with upscatter block from "
+				"group %d with %d sub-iterations", upscatter_start,
+				_num_upscatter_iterations);
+	}
+
+	while (!_old_k_effs.empty())
+		_old_k_effs.pop();
+
+	/* Warm start from the fluxes and k_eff of the previous solve */
+	if (_warm_start && _num_iterations > 0) {
+		log_printf(NORMAL, "Warm start from the previous solution with "
+												"k_eff = %f", _k_eff);
+		_old_k_effs.push(_k_eff);
+	}
+
+	else {
+		/* Initial guess */
+		_old_k_effs.push(1.0);
+
+		/* Set scalar flux to unity for each region */
+		oneFSRFluxes();
+		zeroTrackFluxes();
+
+		/* Set the old source to unity for each Region */
+		#if USE_OPENMP
+		#pragma omp parallel for
+		#endif
+		for (int i = 0; i < _num_FSRs * NUM_ENERGY_GROUPS; i++)
+			_old_source[i] = 1.0;
+	}
+
+	/* Resume from or warm start with a saved solver state */
+	if (!_restart_file.empty())
+		start_iteration = readCheckpoint();
+
+	// Source iteration loop
+	for (int i = start_iteration; i < max_iterations; i++) {
+
+		log_printf(NORMAL, "Iteration %d: k_eff = %f", i, _k_eff);
+
+		/*********************************************************************
+		 * Renormalize scalar and boundary fluxes
+		 *********************************************************************/
+
+#if FUSED_SOURCE_UPDATE
+		/* Compute total fission source with a parallel reduction over the
+		 * FSRs of each fissile material */
+		fission_source = 0;
+
+		for (int b = 0; b < _num_material_buckets; b++) {
+			nu_sigma_f = _material_buckets[b]->getNuSigmaF();
+			start_index = _material_buckets[b]->getNuSigmaFStart();
+			end_index = _material_buckets[b]->getNuSigmaFEnd();
+
+			if (start_index == end_index)
+				continue;
+
+			#if USE_OPENMP
+			#pragma omp parallel for private(r, volume) \
+					reduction(+:fission_source)
+			#endif
+			for (int i = _material_bucket_offsets[b];
+								i < _material_bucket_offsets[b+1]; i++) {
+				r = _material_bucket_FSRs[i];
+				volume = _flat_source_regions[r].getVolume();
+
+				for (int e = start_index; e < end_index; e++)
+					fission_source += nu_sigma_f[e] *
+							_scalar_flux[FSR_INDEX(r, e)] * volume;
+			}
+		}
+
+		/* Renormalize scalar fluxes in each region */
+		renorm_factor = 1.0 / fission_source;
+
+		/* Renormalization angular boundary fluxes for each track */
+		#if USE_OPENMP
+		#pragma omp parallel for
+		#endif
+		for (int i = 0; i < _num_azim; i++) {
+			for (int j = 0; j < _num_tracks[i]; j++)
+				_tracks[i][j].normalizeFluxes(renorm_factor);
+		}
+
+
+		/* Renormalize the scalar fluxes and compute the source and source /
+		 * sigma_t ratios for each region in a single pass */
+		updateSources(renorm_factor);
+
+#else
+		/* Initialize fission source to zero */
+		fission_source = 0;
+
+		/* Compute total fission source to zero for this region */
+		for (int r = 0; r < _num_FSRs; r++) {
+
+			/* Get pointers to important data structures */
+			fsr = &_flat_source_regions[r];
+			material = fsr->getMaterial();
+			nu_sigma_f = material->getNuSigmaF();
+			volume = fsr->getVolume();
+
+			start_index = fsr->getMaterial()->getNuSigmaFStart();
+			end_index = fsr->getMaterial()->getNuSigmaFEnd();
+
+			for (int e = start_index; e < end_index; e++)
+				fission_source += nu_sigma_f[e] * _scalar_flux[FSR_INDEX(r, e)]
+																			* volume;
+		}
+
+		/* Renormalize scalar fluxes in each region */
+		renorm_factor = 1.0 / fission_source;
+
+		#if USE_OPENMP
+		#pragma omp parallel for
+		#endif
+		for (int r = 0; r < _num_FSRs; r++)
+			_flat_source_regions[r].normalizeFluxes(renorm_factor);
+
+		/* Renormalization angular boundary fluxes for each track */
+		#if USE_OPENMP
+		#pragma omp parallel for
+		#endif
+		for (int i = 0; i < _num_azim; i++) {
+			for (int j = 0; j < _num_tracks[i]; j++)
+				_tracks[i][j].normalizeFluxes(renorm_factor);
+		}
+
+
+		/*********************************************************************
+		 * Compute the source for each region
+		 *********************************************************************/
+
+		/* For all regions, find the source */
+		for (int r = 0; r < _num_FSRs; r++) {
+
+			fsr = &_flat_source_regions[r];
+			material = fsr->getMaterial();
+
+			/* Initialize the fission source to zero for this region */
+			fission_source = 0;
+			material = fsr->getMaterial();
+			nu_sigma_f = material->getNuSigmaF();
+			chi = material->getChi();
+			sigma_s = material->getSigmaS();
+
+			start_index = material->getNuSigmaFStart();
+			end_index = material->getNuSigmaFEnd();
+
+			/* Compute total fission source for current region */
+			for (int e = start_index; e < end_index; e++)
+				fission_source += _scalar_flux[FSR_INDEX(r, e)] * nu_sigma_f[e];
+
+			_FSRs_to_fission_source[r] = fission_source;
+
+			/* Compute total scattering source for group G */
+			for (int G = 0; G < NUM_ENERGY_GROUPS; G++) {
+				scatter_source = 0;
+
+				start_index = material->getSigmaSStart(G);
+				end_index = material->getSigmaSEnd(G);
+
+				for (int g = start_index; g < end_index; g++)
+					scatter_source += sigma_s[G*NUM_ENERGY_GROUPS + g]
+					                          * _scalar_flux[FSR_INDEX(r, g)];
+
+				/* Set the total source for region r in group G */
+				_source[FSR_INDEX(r, G)] = ((1.0 / (_old_k_effs.front())) *
+						fission_source * chi[G] + scatter_source) *
+						ONE_OVER_FOUR_PI;
+			}
+		}
+
+#endif
+
+		/*********************************************************************
+		 * Update flux and check for convergence
+		 *********************************************************************/
+
+		/* Sweep energy groups from fast to thermal with the updated fluxes
+		 * and sub-iterate over the upscatter block. With CMFD the mesh
+		 * surface currents are tallied in every sweep so that they are
+		 * available from the last one once the source has converged */
+		if (_energy_gauss_seidel)
+			flux_residual = energyGaussSeidelSweep(upscatter_start);
+
+		else {
+#if !FUSED_SOURCE_UPDATE
+			/* Update pre-computed source / sigma_t ratios */
+			computeRatios();
+#endif
+
+			/* Iteration the flux with the new source */
+			flux_residual = fixedSourceIteration(1, CMFD_ACCEL);
+		}
+
+		/* Enforce neutron balance in each CMFD mesh cell */
+		if (_coarse_mesh_rebalance)
+			coarseMeshRebalance();
+
+		/* Accelerate the spectrum with a coarse energy group solve */
+		if (_coarse_group_bounds.size() > 0)
+			coarseEnergyRebalance();
+
+		/* Update k_eff */
+		updateKeff();
+
+		/* Check each of the stopping criteria which has been enabled */
+		converged = fabs(_old_k_effs.back() - _k_eff) < _keff_tolerance;
+
+		if (_source_tolerance > 0.0) {
+			source_residual = computeSourceResidual();
+			converged = converged && source_residual < _source_tolerance;
+		}
+
+		if (_flux_tolerance > 0.0)
+			converged = converged && flux_residual < _flux_tolerance;
+
+		log_printf(INFO, "Iteration %d: source residual = %e, flux "
+				"residual = %e", i, source_residual, flux_residual);
+
+		/* If converged, return k_eff. The fluxes and currents from the last
+		 * sweep are used for plotting and CMFD without further sweeps */
+		if (converged) {
+
+			_num_iterations = i + 1;
+
+			if (!_checkpoint_file.empty())
+				writeCheckpoint(i + 1);
+
+			#if CMFD_ACCEL
+			_geom->getMesh()->splitCorners();
+			computeXS(_geom->getMesh());
+			if (_plotter->plotCurrent()){
+				//_geom->getMesh()->printCurrents();
+				_plotter->plotNetCurrents(_geom->getMesh());
+				_plotter->plotSurfaceFlux(_geom->getMesh());
+				_plotter->plotXS(_geom->getMesh());
+			}
+
+
+			#endif
+
+			if (_plotter->plotFlux() == true){
+				/* Load fluxes into FSR to flux map */
+				double flux;
+				for (int r=0; r < _num_FSRs; r++) {
+					for (int e=0; e < NUM_ENERGY_GROUPS; e++){
+						flux = _scalar_flux[FSR_INDEX(
+									_geom->getInternalFSRId(r), e)];
+						_FSRs_to_fluxes[e][r] = flux;
+						_FSRs_to_fluxes[NUM_ENERGY_GROUPS][r] =
+							_FSRs_to_fluxes[NUM_ENERGY_GROUPS][r] + flux;
+					}
+				}
+				plotFluxes();
+			}
+
+
+			return _k_eff;
+		}
+
+		/* If not converged, save old k_eff and pop off old_keff from
+		 *  previous iteration */
+		_old_k_effs.push(_k_eff);
+		if (_old_k_effs.size() == NUM_KEFFS_TRACKED)
+			_old_k_effs.pop();
+
+#if !FUSED_SOURCE_UPDATE
+		/* Update sources in each FSR */
+		for (int r = 0; r < _num_FSRs; r++) {
+			fsr = &_flat_source_regions[r];
+
+			for (int e = 0; e < NUM_ENERGY_GROUPS; e++)
+				_old_source[FSR_INDEX(r, e)] = _source[FSR_INDEX(r, e)];
+		}
+#endif
+
+		/* Save the solver state every checkpoint interval iterations */
+		if (!_checkpoint_file.empty() && _checkpoint_interval > 0 &&
+									(i + 1) % _checkpoint_interval == 0)
+			writeCheckpoint(i + 1);
+	}
+
+	log_printf(WARNING, "Unable to converge the source after %d iterations",
+															max_iterations);
+
+	_num_iterations = max_iterations;
+
+	if (!_checkpoint_file.empty())
+		writeCheckpoint(max_iterations);
+
+	if (_plotter->plotFlux() == true){
+		log_printf(NORMAL, "Plotting fluxes...");
+		/* Load fluxes into FSR to flux map */
+		double flux;
+		for (int r=0; r < _num_FSRs; r++) {
+			for (int e=0; e < NUM_ENERGY_GROUPS; e++){
+				flux = _scalar_flux[FSR_INDEX(_geom->getInternalFSRId(r), e)];
+				_FSRs_to_fluxes[e][r] = flux;
+				_FSRs_to_fluxes[NUM_ENERGY_GROUPS][r] =
+						_FSRs_to_fluxes[NUM_ENERGY_GROUPS][r] + flux;
+			}
+		}
+		plotFluxes();
+	}
+
+
+
+
+
+
+	return _k_eff;
+}
+
+/**
+ * Copies the cross-sections of each material bucket for every case of a
+ * batched solve into arrays with the case index innermost, so that the
+ * sweep and source loops run over contiguous cases. The materials of each
+ * case are matched to the geometry's materials by id, and a bucket keeps
+ * the geometry's cross-sections if a case does not define its material
+ * @param case_materials the materials of each case indexed by material id
+ */
+void Solver::initializeBatch(std::vector<std::map<int, Material*> >
+															case_materials) {
+
+	int K = _batch_size;
+	int G = NUM_ENERGY_GROUPS;
+	int index = 0;
+	Material* material;
+	Track* track;
+	std::map<int, Material*>::iterator iter;
+
+	_batch_sigma_t = new double[_num_material_buckets * G * K];
+	_batch_sigma_a = new double[_num_material_buckets * G * K];
+	_batch_nu_sigma_f = new double[_num_material_buckets * G * K];
+	_batch_chi = new double[_num_material_buckets * G * K];
+	_batch_sigma_s = new double[_num_material_buckets * G * G * K];
+	_batch_scalar_flux = new double[_num_FSRs * G * K];
+	_batch_ratios = new double[_num_FSRs * G * K];
+	_batch_polar_fluxes = new double[_num_polar_fluxes * K];
+	_batch_k_eff = new double[K];
+	_batch_old_k_eff = new double[K];
+	_batch_cases = new int[K];
+	_FSR_buckets = new int[_num_FSRs];
+	_track_offsets = new int[_num_azim];
+	_batch_tracks_out = new int[_num_polar_fluxes / (2 * GRP_TIMES_ANG)];
+	_batch_tracks_in = new int[_num_polar_fluxes / (2 * GRP_TIMES_ANG)];
+
+	for (int b = 0; b < _num_material_buckets; b++) {
+		for (int i = _material_bucket_offsets[b];
+							i < _material_bucket_offsets[b+1]; i++)
+			_FSR_buckets[_material_bucket_FSRs[i]] = b;
+
+		for (int k = 0; k < K; k++) {
+			iter = case_materials[k].find(_material_buckets[b]->getId());
+
+			if (iter != case_materials[k].end())
+				material = iter->second;
+			else
+				material = _material_buckets[b];
+
+			for (int G1 = 0; G1 < G; G1++) {
+				_batch_sigma_t[(b * G + G1) * K + k] =
+												material->getSigmaT()[G1];
+				_batch_sigma_a[(b * G + G1) * K + k] =
+												material->getSigmaA()[G1];
+				_batch_nu_sigma_f[(b * G + G1) * K + k] =
+											material->getNuSigmaF()[G1];
+				_batch_chi[(b * G + G1) * K + k] = material->getChi()[G1];
+
+				for (int g = 0; g < G; g++)
+					_batch_sigma_s[((b * G + G1) * G + g) * K + k] =
+									material->getSigmaS()[G1 * G + g];
+			}
+		}
+	}
+
+	/* Number the tracks to index their polar fluxes, and find the tracks
+	 * into which each track's outgoing fluxes are transferred */
+	for (int i = 0; i < _num_azim; i++) {
+		_track_offsets[i] = index;
+		index += _num_tracks[i];
+	}
+
+	for (int i = 0; i < _num_azim; i++) {
+		for (int j = 0; j < _num_tracks[i]; j++) {
+			track = &_tracks[i][j];
+			_batch_tracks_out[_track_offsets[i] + j] =
+									getTrackIndex(track->getTrackOut());
+			_batch_tracks_in[_track_offsets[i] + j] =
+									getTrackIndex(track->getTrackIn());
+		}
+	}
+
+	if (_pre_factor_array == NULL)
+		initializePreFactorArray();
+
+	for (int k = 0; k < K; k++) {
+		_batch_cases[k] = k;
+		_batch_k_eff[k] = 1.0;
+		_batch_old_k_eff[k] = 1.0;
+	}
+
+	for (int i = 0; i < _num_FSRs * G * K; i++)
+		_batch_scalar_flux[i] = 1.0;
+
+	for (int i = 0; i < _num_polar_fluxes * K; i++)
+		_batch_polar_fluxes[i] = 0.0;
+
+	return;
+}
+
+
+/**
+ * Frees the arrays of a batched solve
+ */
+void Solver::deleteBatch() {
+
+	delete [] _batch_sigma_t;
+	delete [] _batch_sigma_a;
+	delete [] _batch_nu_sigma_f;
+	delete [] _batch_chi;
+	delete [] _batch_sigma_s;
+	delete [] _batch_scalar_flux;
+	delete [] _batch_ratios;
+	delete [] _batch_polar_fluxes;
+	delete [] _batch_k_eff;
+	delete [] _batch_old_k_eff;
+	delete [] _batch_cases;
+	delete [] _FSR_buckets;
+	delete [] _track_offsets;
+	delete [] _batch_tracks_out;
+	delete [] _batch_tracks_in;
+
+	return;
+}
+
+
+/**
+ * Returns the index of a track in the order of azimuthal angle and track
+ * @param track pointer to the track
+ * @return the track's index
+ */
+int Solver::getTrackIndex(Track* track) {
+
+	for (int i = 0; i < _num_azim; i++) {
+		if (track >= &_tracks[i][0] && track < &_tracks[i][_num_tracks[i]])
+			return _track_offsets[i] + (track - &_tracks[i][0]);
+	}
+
+	log_printf(ERROR, "Unable to find the index of a track which is not "
+											"in the track generator");
+	return -1;
+}
+
+
+/**
+ * Swaps all of the cross-sections, fluxes and eigenvalues of two slots in
+ * the case dimension of the batch arrays
+ * @param a the first slot
+ * @param b the second slot
+ */
+void Solver::swapBatchCases(int a, int b) {
+
+	int K = _batch_size;
+	int G = NUM_ENERGY_GROUPS;
+
+	for (int i = 0; i < _num_material_buckets * G; i++) {
+		std::swap(_batch_sigma_t[i * K + a], _batch_sigma_t[i * K + b]);
+		std::swap(_batch_sigma_a[i * K + a], _batch_sigma_a[i * K + b]);
+		std::swap(_batch_nu_sigma_f[i * K + a], _batch_nu_sigma_f[i * K + b]);
+		std::swap(_batch_chi[i * K + a], _batch_chi[i * K + b]);
+	}
+
+	for (int i = 0; i < _num_material_buckets * G * G; i++)
+		std::swap(_batch_sigma_s[i * K + a], _batch_sigma_s[i * K + b]);
+
+	for (int i = 0; i < _num_FSRs * G; i++) {
+		std::swap(_batch_scalar_flux[i * K + a], _batch_scalar_flux[i * K + b]);
+		std::swap(_batch_ratios[i * K + a], _batch_ratios[i * K + b]);
+	}
+
+	for (int i = 0; i < _num_polar_fluxes; i++)
+		std::swap(_batch_polar_fluxes[i * K + a],
+								_batch_polar_fluxes[i * K + b]);
+
+	std::swap(_batch_k_eff[a], _batch_k_eff[b]);
+	std::swap(_batch_old_k_eff[a], _batch_old_k_eff[b]);
+	std::swap(_batch_cases[a], _batch_cases[b]);
+
+	return;
+}
+
+
+/**
+ * Sweeps all tracks once for the first num_cases slots of a batched solve.
+ * Each segment is loaded once and applied to every case with the cases
+ * innermost. The pre-factors stored in the segments are for one set of
+ * cross-sections only, so those of each case are interpolated in the
+ * pre-factor table. As in transportSweep, each thread sweeps a pair
+ * of reflecting azimuthal angles, so a track's fluxes are only ever
+ * transferred into tracks of the same thread
+ * @param num_cases the number of active slots
+ */
+void Solver::batchTransportSweep(int num_cases) {
+
+	int K = _batch_size;
+	int G = NUM_ENERGY_GROUPS;
+	int num_threads = _num_azim / 2;
+	int num_angular = GRP_TIMES_ANG * K;
+
+	#if USE_OPENMP
+	#pragma omp parallel for
+	#endif
+	for (int r = 0; r < _num_FSRs; r++) {
+		for (int i = 0; i < G * K; i++)
+			_batch_scalar_flux[r * G * K + i] = 0.0;
+	}
+
+	#if USE_OPENMP
+	#pragma omp parallel for num_threads(num_threads)
+	#endif
+	for (int t = 0; t < num_threads; t++) {
+
+		Track* track;
+		segment* seg;
+		double* weights;
+		double* polar_fluxes;
+		double* out_fluxes;
+		double* sigma_t;
+		double* ratios;
+		double* psi;
+		double delta;
+		int n, fsr_id;
+		double* fsr_flux = new double[G * K];
+		double* sigma_t_l = new double[G * K];
+		int* index = new int[G * K];
+
+		int j = t;
+		while (j < _num_azim) {
+
+		for (int k = 0; k < _num_tracks[j]; k++) {
+			track = &_tracks[j][k];
+			n = _track_offsets[j] + k;
+			weights = track->getPolarWeights();
+			polar_fluxes = &_batch_polar_fluxes[n * 2 * num_angular];
+
+			/* Sweep the segments forward with the fluxes of the first half
+			 * and backward with those of the second half */
+			for (int d = 0; d < 2; d++) {
+				psi = &polar_fluxes[d * num_angular];
+
+				for (int s = 0; s < track->getNumSegments(); s++) {
+					seg = track->getSegment(d == 0 ? s :
+										track->getNumSegments() - s - 1);
+					fsr_id = seg->_region_id;
+					sigma_t = &_batch_sigma_t[_FSR_buckets[fsr_id] * G * K];
+					ratios = &_batch_ratios[fsr_id * G * K];
+
+					/* Find each case's pre-factor table entries for all
+					 * polar angles */
+					for (int i = 0; i < G * K; i++) {
+						fsr_flux[i] = 0.0;
+						sigma_t_l[i] = std::min(sigma_t[i] * seg->_length,
+																	10.0);
+						index[i] = sigma_t_l[i] / _pre_factor_spacing;
+						index[i] = std::min(index[i] * 2 * NUM_POLAR_ANGLES,
+												_pre_factor_max_index);
+					}
+
+					for (int e = 0; e < G; e++) {
+						for (int p = 0; p < NUM_POLAR_ANGLES; p++) {
+							for (int c = 0; c < num_cases; c++) {
+								delta = (psi[(e * NUM_POLAR_ANGLES + p) * K + c]
+									- ratios[e * K + c]) * (1 -
+									(_pre_factor_array[index[e * K + c] + 2 * p]
+									* sigma_t_l[e * K + c] +
+									_pre_factor_array[index[e * K + c]
+														+ 2 * p + 1]));
+								fsr_flux[e * K + c] += delta * weights[p];
+								psi[(e * NUM_POLAR_ANGLES + p) * K + c] -=
+																	delta;
+							}
+						}
+					}
+
+					#if USE_OPENMP
+					omp_set_lock(&_FSR_locks[fsr_id]);
+					#endif
+					for (int e = 0; e < G; e++) {
+						for (int c = 0; c < num_cases; c++)
+							_batch_scalar_flux[(fsr_id * G + e) * K + c] +=
+														fsr_flux[e * K + c];
+					}
+					#if USE_OPENMP
+					omp_unset_lock(&_FSR_locks[fsr_id]);
+					#endif
+				}
+
+				/* Transfer the flux to the outgoing or incoming track */
+				if (d == 0)
+					out_fluxes = &_batch_polar_fluxes[(2 * _batch_tracks_out[n]
+									+ track->isReflOut()) * num_angular];
+				else
+					out_fluxes = &_batch_polar_fluxes[(2 * _batch_tracks_in[n]
+									+ track->isReflIn()) * num_angular];
+
+				memcpy(out_fluxes, psi, num_angular * sizeof(double));
+			}
+		}
+
+		if (j < num_threads)
+			j = _num_azim - j - 1;
+		else
+			break;
+		}
+
+		delete [] fsr_flux;
+		delete [] sigma_t_l;
+		delete [] index;
+	}
+
+	/* Add in the source term and normalize the flux to the volume */
+	#if USE_OPENMP
+	#pragma omp parallel for
+	#endif
+	for (int r = 0; r < _num_FSRs; r++) {
+		double* sigma_t = &_batch_sigma_t[_FSR_buckets[r] * G * K];
+		double volume = _flat_source_regions[r].getVolume();
+
+		for (int e = 0; e < G; e++) {
+			for (int c = 0; c < num_cases; c++)
+				_batch_scalar_flux[(r * G + e) * K + c] = FOUR_PI *
+						_batch_ratios[(r * G + e) * K + c] + 0.5 *
+						_batch_scalar_flux[(r * G + e) * K + c] /
+						(sigma_t[e * K + c] * volume);
+		}
+	}
+
+	return;
+}
+
+
+/**
+ * Solves for k_eff of several cross-section sets on the same geometry and
+ * tracks at once. Each source iteration sweeps the segments a single time
+ * for all of the cases which have not yet converged, with separate scalar
+ * and angular fluxes, sources and k_eff for each case. A case whose k_eff
+ * converges is swapped out of the active slots and no longer swept. The
+ * case sources use a Jacobi iteration in energy without any acceleration
+ * @param case_materials the materials of each case indexed by material id
+ * @param max_iterations the maximum number of source iterations
+ * @return k_eff of each case
+ */
+std::vector<double> Solver::computeKeffBatch(std::vector<std::map<int,
+							Material*> > case_materials, int max_iterations) {
+
+	int K = case_materials.size();
+	int G = NUM_ENERGY_GROUPS;
+	int num_active = K;
+	std::vector<double> k_effs(K, 0.0);
+	std::vector<double> fission(K), absorption(K), renorm_factor(K);
+
+	log_printf(NORMAL, "Computing k_eff for a batch of %d cases...", K);
+
+	if (_segment_database != NULL)
+		log_printf(ERROR, "Unable to sweep a batch of cases over the "
+				"segments shared read-only in %s",
+				_segment_database->getPath().c_str());
+
+	if (_track_generator->getNumTiles() > 1)
+		log_printf(ERROR, "Unable to sweep a batch of cases over tracks "
+				"which are cut into %d tiles", _track_generator->getNumTiles());
+
+	checkTrackSpacing();
+
+	_batch_size = K;
+	_batch_num_iterations.assign(K, max_iterations);
+	initializeBatch(case_materials);
+
+	for (int i = 0; i < max_iterations && num_active > 0; i++) {
+
+		log_printf(NORMAL, "Iteration %d: %d active cases", i, num_active);
+
+		/* Compute the total fission source of each case */
+		for (int c = 0; c < num_active; c++)
+			fission[c] = 0.0;
+
+		for (int r = 0; r < _num_FSRs; r++) {
+			double* nu_sigma_f = &_batch_nu_sigma_f[_FSR_buckets[r] * G * K];
+			double volume = _flat_source_regions[r].getVolume();
+
+			for (int e = 0; e < G; e++) {
+				for (int c = 0; c < num_active; c++)
+					fission[c] += nu_sigma_f[e * K + c] *
+						_batch_scalar_flux[(r * G + e) * K + c] * volume;
+			}
+		}
+
+		for (int c = 0; c < num_active; c++)
+			renorm_factor[c] = 1.0 / fission[c];
+
+		/* Renormalize the boundary fluxes of each case */
+		#if USE_OPENMP
 		#pragma omp parallel for
 		#endif
-		for (int r = 0; r < _num_FSRs; r++)
-			_flat_source_regions[r].normalizeFluxes(renorm_factor);
+		for (int n = 0; n < _num_polar_fluxes; n++) {
+			for (int c = 0; c < num_active; c++)
+				_batch_polar_fluxes[n * K + c] *= renorm_factor[c];
+		}
+
+		/* Renormalize the scalar fluxes and compute the source / sigma_t
+		 * ratios of each case in each FSR */
+		#if USE_OPENMP
+		#pragma omp parallel
+		{
+		#endif
+
+		double* fission_source = new double[K];
+		double* source = new double[K];
+
+		#if USE_OPENMP
+		#pragma omp for
+		#endif
+		for (int r = 0; r < _num_FSRs; r++) {
+			int b = _FSR_buckets[r];
+			double* flux = &_batch_scalar_flux[r * G * K];
+			double* nu_sigma_f = &_batch_nu_sigma_f[b * G * K];
+			double* sigma_s = &_batch_sigma_s[b * G * G * K];
+			double* sigma_t = &_batch_sigma_t[b * G * K];
+			double* chi = &_batch_chi[b * G * K];
+
+			for (int c = 0; c < num_active; c++)
+				fission_source[c] = 0.0;
+
+			for (int e = 0; e < G; e++) {
+				for (int c = 0; c < num_active; c++) {
+					flux[e * K + c] *= renorm_factor[c];
+					fission_source[c] += nu_sigma_f[e * K + c] *
+														flux[e * K + c];
+				}
+			}
+
+			/* As in computeKeff, the fission source is scaled by k_eff
+			 * from the iteration before the last one */
+			for (int G1 = 0; G1 < G; G1++) {
+				for (int c = 0; c < num_active; c++)
+					source[c] = chi[G1 * K + c] * fission_source[c] /
+													_batch_old_k_eff[c];
+
+				for (int g = 0; g < G; g++) {
+					for (int c = 0; c < num_active; c++)
+						source[c] += sigma_s[(G1 * G + g) * K + c] *
+														flux[g * K + c];
+				}
+
+				for (int c = 0; c < num_active; c++)
+					_batch_ratios[(r * G + G1) * K + c] = source[c] *
+								ONE_OVER_FOUR_PI / sigma_t[G1 * K + c];
+			}
+		}
+
+		delete [] fission_source;
+		delete [] source;
+
+		#if USE_OPENMP
+		}
+		#endif
+
+		batchTransportSweep(num_active);
+
+		/* Update k_eff of each case */
+		for (int c = 0; c < num_active; c++) {
+			fission[c] = 0.0;
+			absorption[c] = 0.0;
+		}
+
+		for (int r = 0; r < _num_FSRs; r++) {
+			int b = _FSR_buckets[r];
+			double volume = _flat_source_regions[r].getVolume();
+
+			for (int e = 0; e < G; e++) {
+				for (int c = 0; c < num_active; c++) {
+					fission[c] += _batch_nu_sigma_f[(b * G + e) * K + c] *
+						_batch_scalar_flux[(r * G + e) * K + c] * volume;
+					absorption[c] += _batch_sigma_a[(b * G + e) * K + c] *
+						_batch_scalar_flux[(r * G + e) * K + c] * volume;
+				}
+			}
+		}
+
+		for (int c = 0; c < num_active; c++) {
+			_batch_old_k_eff[c] = _batch_k_eff[c];
+			_batch_k_eff[c] = fission[c] / absorption[c];
+			k_effs[_batch_cases[c]] = _batch_k_eff[c];
+		}
+
+		/* Swap each converged case out of the active slots */
+		for (int c = num_active - 1; c >= 0; c--) {
+			if (fabs(_batch_k_eff[c] - _batch_old_k_eff[c]) <
+														_keff_tolerance) {
+				log_printf(INFO, "Case %d converged after %d iterations "
+						"with k_eff = %f", _batch_cases[c], i + 1,
+						_batch_k_eff[c]);
+				_batch_num_iterations[_batch_cases[c]] = i + 1;
+				num_active--;
+				if (c != num_active)
+					swapBatchCases(c, num_active);
+			}
+		}
+	}
+
+	if (num_active > 0)
+		log_printf(WARNING, "Unable to converge the source of %d cases "
+						"after %d iterations", num_active, max_iterations);
+
+	deleteBatch();
+
+	return k_effs;
+}
+
+
+/**
+ * Returns the number of source iterations of each case of the last call
+ * to computeKeffBatch
+ * @return the number of source iterations of each case
+ */
+std::vector<int> Solver::getBatchNumIterations() {
+	return _batch_num_iterations;
+}
+
+
+
+/**
+ * Computes the eigenvalues of a small upper Hessenberg matrix using the
+ * shifted QR algorithm. The matrix is stored row-major and is destroyed.
+ * Real parts of the eigenvalues are stored in wr and imaginary parts in wi
+ * @param a the n x n upper Hessenberg matrix
+ * @param n the dimension of the matrix
+ * @param wr array for the real parts of the eigenvalues
+ * @param wi array for the imaginary parts of the eigenvalues
+ */
+static void hessenbergEigenvalues(double* a, int n, double* wr, double* wi) {
+
+	int nn, m, l, k, j, its, i, mmin;
+	double z = 0, y, x, w, v, u, t, s, r = 0, q = 0, p = 0, anorm = 0;
+
+	#define A(row, col) a[(row) * n + (col)]
+
+	for (i = 0; i < n; i++) {
+		for (j = std::max(i-1, 0); j < n; j++)
+			anorm += fabs(A(i,j));
+	}
+
+	nn = n - 1;
+	t = 0.0;
+
+	while (nn >= 0) {
+		its = 0;
+
+		do {
+			/* Look for a single small subdiagonal element */
+			for (l = nn; l >= 1; l--) {
+				s = fabs(A(l-1,l-1)) + fabs(A(l,l));
+				if (s == 0.0)
+					s = anorm;
+				if (fabs(A(l,l-1)) + s == s) {
+					A(l,l-1) = 0.0;
+					break;
+				}
+			}
+
+			x = A(nn,nn);
+
+			/* One root found */
+			if (l == nn) {
+				wr[nn] = x + t;
+				wi[nn--] = 0.0;
+			}
+
+			else {
+				y = A(nn-1,nn-1);
+				w = A(nn,nn-1) * A(nn-1,nn);
+
+				/* Two roots found */
+				if (l == nn-1) {
+					p = 0.5 * (y - x);
+					q = p * p + w;
+					z = sqrt(fabs(q));
+					x += t;
+
+					/* Real pair */
+					if (q >= 0.0) {
+						z = p + (p >= 0.0 ? fabs(z) : -fabs(z));
+						wr[nn-1] = wr[nn] = x + z;
+						if (z != 0.0)
+							wr[nn] = x - w / z;
+						wi[nn-1] = wi[nn] = 0.0;
+					}
+
+					/* Complex pair */
+					else {
+						wr[nn-1] = wr[nn] = x + p;
+						wi[nn-1] = -(wi[nn] = z);
+					}
+
+					nn -= 2;
+				}
+
+				/* No roots found yet, continue the iteration */
+				else {
+					if (its == 30)
+						log_printf(ERROR, "Unable to compute the eigenvalues of "
+								"the Arnoldi Hessenberg matrix");
+
+					/* Form an exceptional shift */
+					if (its == 10 || its == 20) {
+						t += x;
+						for (i = 0; i <= nn; i++)
+							A(i,i) -= x;
+						s = fabs(A(nn,nn-1)) + fabs(A(nn-1,nn-2));
+						y = x = 0.75 * s;
+						w = -0.4375 * s * s;
+					}
+
+					++its;
+
+					/* Look for two consecutive small subdiagonal elements */
+					for (m = nn-2; m >= l; m--) {
+						z = A(m,m);
+						r = x - z;
+						s = y - z;
+						p = (r * s - w) / A(m+1,m) + A(m,m+1);
+						q = A(m+1,m+1) - z - r - s;
+						r = A(m+2,m+1);
+						s = fabs(p) + fabs(q) + fabs(r);
+						p /= s;
+						q /= s;
+						r /= s;
+						if (m == l)
+							break;
+						u = fabs(A(m,m-1)) * (fabs(q) + fabs(r));
+						v = fabs(p) * (fabs(A(m-1,m-1)) + fabs(z)
+										+ fabs(A(m+1,m+1)));
+						if (u + v == v)
+							break;
+					}
+
+					for (i = m+2; i <= nn; i++) {
+						A(i,i-2) = 0.0;
+						if (i != m+2)
+							A(i,i-3) = 0.0;
+					}
+
+					/* Double QR step on rows l to nn and columns m to nn */
+					for (k = m; k <= nn-1; k++) {
+						if (k != m) {
+							p = A(k,k-1);
+							q = A(k+1,k-1);
+							r = 0.0;
+							if (k != nn-1)
+								r = A(k+2,k-1);
+							if ((x = fabs(p) + fabs(q) + fabs(r)) != 0.0) {
+								p /= x;
+								q /= x;
+								r /= x;
+							}
+						}
+
+						s = sqrt(p * p + q * q + r * r);
+						if (p < 0.0)
+							s = -s;
+
+						if (s != 0.0) {
+							if (k == m) {
+								if (l != m)
+									A(k,k-1) = -A(k,k-1);
+							}
+							else
+								A(k,k-1) = -s * x;
+
+							p += s;
+							x = p / s;
+							y = q / s;
+							z = r / s;
+							q /= p;
+							r /= p;
+
+							/* Row modification */
+							for (j = k; j <= nn; j++) {
+								p = A(k,j) + q * A(k+1,j);
+								if (k != nn-1) {
+									p += r * A(k+2,j);
+									A(k+2,j) -= p * z;
+								}
+								A(k+1,j) -= p * y;
+								A(k,j) -= p * x;
+							}
+
+							/* Column modification */
+							mmin = nn < k+3 ? nn : k+3;
+							for (i = l; i <= mmin; i++) {
+								p = x * A(i,k) + y * A(i,k+1);
+								if (k != nn-1) {
+									p += z * A(i,k+2);
+									A(i,k+2) -= p * r;
+								}
+								A(i,k+1) -= p * q;
+								A(i,k) -= p;
+							}
+						}
+					}
+				}
+			}
+		} while (l < nn-1);
+	}
+
+	#undef A
+
+	return;
+}
+
+
+/**
+ * Solves a small dense linear system using Gaussian elimination with
+ * partial pivoting. The matrix and right hand side are destroyed
+ * @param a the n x n matrix stored row-major
+ * @param b the right hand side, which holds the solution on return
+ * @param n the dimension of the system
+ */
+static void solveDenseSystem(double* a, double* b, int n) {
+
+	double pivot, factor, temp;
+	int p;
+
+	for (int c = 0; c < n; c++) {
+		p = c;
+		for (int i = c+1; i < n; i++) {
+			if (fabs(a[i * n + c]) > fabs(a[p * n + c]))
+				p = i;
+		}
+
+		if (p != c) {
+			for (int j = 0; j < n; j++) {
+				temp = a[c * n + j];
+				a[c * n + j] = a[p * n + j];
+				a[p * n + j] = temp;
+			}
+			temp = b[c];
+			b[c] = b[p];
+			b[p] = temp;
+		}
+
+		pivot = a[c * n + c];
+		if (pivot == 0.0)
+			pivot = a[c * n + c] = 1E-300;
+
+		for (int i = c+1; i < n; i++) {
+			factor = a[i * n + c] / pivot;
+			for (int j = c; j < n; j++)
+				a[i * n + j] -= factor * a[c * n + j];
+			b[i] -= factor * b[c];
+		}
+	}
+
+	/* Back substitution */
+	for (int i = n-1; i >= 0; i--) {
+		for (int j = i+1; j < n; j++)
+			b[i] -= a[i * n + j] * b[j];
+		b[i] /= a[i * n + i];
+	}
+
+	return;
+}
+
+
+/**
+ * Computes the normalized eigenvector of a small dense matrix for a known
+ * real eigenvalue using inverse iteration
+ * @param a the n x n matrix stored row-major (not modified)
+ * @param n the dimension of the matrix
+ * @param eigenvalue the real eigenvalue
+ * @param y array for the eigenvector
+ */
+static void denseEigenvector(double* a, int n, double eigenvalue, double* y) {
+
+	double* lu = new double[n * n];
+	double shift = eigenvalue + 1E-10 * std::max(fabs(eigenvalue), 1.0);
+	double norm;
+
+	for (int i = 0; i < n; i++)
+		y[i] = 1.0;
+
+	for (int iter = 0; iter < 3; iter++) {
+
+		/* Copy the shifted matrix */
+		for (int i = 0; i < n * n; i++)
+			lu[i] = a[i];
+		for (int i = 0; i < n; i++)
+			lu[i * n + i] -= shift;
+
+		solveDenseSystem(lu, y, n);
+
+		/* Normalize the new iterate */
+		norm = 0.0;
+		for (int i = 0; i < n; i++)
+			norm += y[i] * y[i];
+		norm = sqrt(norm);
+
+		for (int i = 0; i < n; i++)
+			y[i] /= norm;
+	}
+
+	delete [] lu;
+
+	return;
+}
+
+
+/**
+ * Returns the length of the state vector used by the Krylov solvers. The
+ * state holds the scalar flux for each FSR and energy group followed by
+ * the polar fluxes for both directions of each track
+ * @return the length of the Krylov state vector
+ */
+int Solver::getKrylovStateSize() {
+	return _num_FSRs * NUM_ENERGY_GROUPS + _num_polar_fluxes;
+}
+
+
+/**
+ * Copies the scalar fluxes in each FSR and the polar fluxes on each track
+ * into a Krylov state vector
+ * @param x the state vector
+ */
+void Solver::packKrylovState(double* x) {
+
+	double* polar_fluxes;
+	int index = _num_FSRs * NUM_ENERGY_GROUPS;
+
+	for (int r = 0; r < _num_FSRs; r++) {
+		for (int e = 0; e < NUM_ENERGY_GROUPS; e++)
+			x[r * NUM_ENERGY_GROUPS + e] = _scalar_flux[FSR_INDEX(r, e)];
+	}
+
+	for (int i = 0; i < _num_azim; i++) {
+		for (int j = 0; j < _num_tracks[i]; j++) {
+			polar_fluxes = _tracks[i][j].getPolarFluxes();
+			for (int pe = 0; pe < 2 * GRP_TIMES_ANG; pe++)
+				x[index++] = polar_fluxes[pe];
+		}
+	}
+
+	return;
+}
+
+
+/**
+ * Copies a Krylov state vector into the scalar fluxes in each FSR and the
+ * polar fluxes on each track
+ * @param x the state vector
+ */
+void Solver::unpackKrylovState(double* x) {
+
+	double* polar_fluxes;
+	int index = _num_FSRs * NUM_ENERGY_GROUPS;
+
+	for (int r = 0; r < _num_FSRs; r++) {
+		for (int e = 0; e < NUM_ENERGY_GROUPS; e++)
+			_flat_source_regions[r].setFlux(e, x[r * NUM_ENERGY_GROUPS + e]);
+	}
+
+	for (int i = 0; i < _num_azim; i++) {
+		for (int j = 0; j < _num_tracks[i]; j++) {
+			polar_fluxes = _tracks[i][j].getPolarFluxes();
+			for (int pe = 0; pe < 2 * GRP_TIMES_ANG; pe++)
+				polar_fluxes[pe] = x[index++];
+		}
+	}
+
+	return;
+}
+
+
+/**
+ * Applies the within-sweep scattering operator to a Krylov state vector:
+ * y = x - K(x) where K is one transport sweep with the scattering source
+ * computed from the scalar fluxes in x and incoming polar fluxes from x.
+ * This is the matrix-free operator for the GMRES fixed source solves
+ * @param x the input state vector
+ * @param y the output state vector
+ */
+void Solver::krylovScatterSweep(double* x, double* y) {
+
+	int size = getKrylovStateSize();
+	double scatter_source;
+	double* sigma_s_values;
+	int* sigma_s_columns;
+	int* sigma_s_row_offsets;
+	Material* material;
+
+	unpackKrylovState(x);
+
+	/* Compute the scattering source from the scalar flux in x */
+	#if USE_OPENMP
+	#pragma omp parallel for private(material, sigma_s_values, \
+				sigma_s_columns, sigma_s_row_offsets, scatter_source)
+	#endif
+	for (int r = 0; r < _num_FSRs; r++) {
+		material = _flat_source_regions[r].getMaterial();
+		sigma_s_values = material->getSigmaSValues();
+		sigma_s_columns = material->getSigmaSColumns();
+		sigma_s_row_offsets = material->getSigmaSRowOffsets();
+
+		for (int G = 0; G < NUM_ENERGY_GROUPS; G++) {
+			scatter_source = 0;
+
+			for (int k = sigma_s_row_offsets[G];
+								k < sigma_s_row_offsets[G+1]; k++)
+				scatter_source += sigma_s_values[k]
+				        * x[r * NUM_ENERGY_GROUPS + sigma_s_columns[k]];
+
+			_source[FSR_INDEX(r, G)] = scatter_source * ONE_OVER_FOUR_PI;
+		}
+	}
+
+	computeRatios();
+	fixedSourceIteration(1);
+	packKrylovState(y);
+
+	for (int i = 0; i < size; i++)
+		y[i] = x[i] - y[i];
+
+	return;
+}
+
+
+/**
+ * Solves the multigroup fixed source problem with a given fission source
+ * using restarted GMRES with the transport sweep as the matrix-free
+ * operator. On return the FSR scalar fluxes and track polar fluxes hold
+ * the solution
+ * @param fission_rates the fission production rate in each FSR
+ * @param x the state vector for the solution
+ * @return the number of transport sweeps
+ */
+int Solver::solveFixedFissionSource(double* fission_rates, double* x) {
+
+	int size = getKrylovStateSize();
+	int m = _num_gmres_vectors;
+	int num_sweeps = 0;
+	double beta, b_norm, temp, h_ij;
+	double* chi;
+	double volume;
+
+	double** v = new double*[m+1];
+	for (int j = 0; j <= m; j++)
+		v[j] = new double[size];
+	double* h = new double[(m+1) * m];
+	double* cs = new double[m];
+	double* sn = new double[m];
+	double* g = new double[m+1];
+	double* w = new double[size];
+	double* b = new double[size];
+
+	/* The right hand side is one sweep of the fission source with zero
+	 * incoming polar fluxes */
+	zeroTrackFluxes();
+
+	for (int r = 0; r < _num_FSRs; r++) {
+		chi = _flat_source_regions[r].getMaterial()->getChi();
+		volume = _flat_source_regions[r].getVolume();
+
+		for (int G = 0; G < NUM_ENERGY_GROUPS; G++)
+			_source[FSR_INDEX(r, G)] = chi[G] * fission_rates[r] / volume
+														* ONE_OVER_FOUR_PI;
+	}
+
+	computeRatios();
+	fixedSourceIteration(1);
+	packKrylovState(b);
+	num_sweeps++;
+
+	b_norm = 0.0;
+	for (int i = 0; i < size; i++) {
+		b_norm += b[i] * b[i];
+		x[i] = 0.0;
+	}
+	b_norm = sqrt(b_norm);
+
+	/* Restarted GMRES on (I - K) x = b */
+	for (int restart = 0; restart < MAX_ITERATIONS && b_norm > 0.0; restart++) {
+
+		/* Compute the initial residual */
+		if (restart == 0) {
+			for (int i = 0; i < size; i++)
+				v[0][i] = b[i];
+		}
+		else {
+			krylovScatterSweep(x, w);
+			num_sweeps++;
+			for (int i = 0; i < size; i++)
+				v[0][i] = b[i] - w[i];
+		}
+
+		beta = 0.0;
+		for (int i = 0; i < size; i++)
+			beta += v[0][i] * v[0][i];
+		beta = sqrt(beta);
+
+		if (beta / b_norm < _gmres_tolerance)
+			break;
+
+		for (int i = 0; i < size; i++)
+			v[0][i] /= beta;
+
+		for (int i = 0; i <= m; i++)
+			g[i] = 0.0;
+		g[0] = beta;
+
+		int k;
+		for (k = 0; k < m; k++) {
+
+			/* Arnoldi step with modified Gram-Schmidt */
+			krylovScatterSweep(v[k], w);
+			num_sweeps++;
+
+			for (int i = 0; i <= k; i++) {
+				h_ij = 0.0;
+				for (int l = 0; l < size; l++)
+					h_ij += w[l] * v[i][l];
+				h[i * m + k] = h_ij;
+				for (int l = 0; l < size; l++)
+					w[l] -= h_ij * v[i][l];
+			}
+
+			temp = 0.0;
+			for (int l = 0; l < size; l++)
+				temp += w[l] * w[l];
+			h[(k+1) * m + k] = sqrt(temp);
+
+			if (h[(k+1) * m + k] != 0.0) {
+				for (int l = 0; l < size; l++)
+					v[k+1][l] = w[l] / h[(k+1) * m + k];
+			}
+
+			/* Apply the previous Givens rotations to the new column */
+			for (int i = 0; i < k; i++) {
+				temp = cs[i] * h[i * m + k] + sn[i] * h[(i+1) * m + k];
+				h[(i+1) * m + k] = -sn[i] * h[i * m + k]
+											+ cs[i] * h[(i+1) * m + k];
+				h[i * m + k] = temp;
+			}
+
+			/* Compute and apply a new Givens rotation */
+			temp = sqrt(h[k * m + k] * h[k * m + k]
+							+ h[(k+1) * m + k] * h[(k+1) * m + k]);
+			cs[k] = h[k * m + k] / temp;
+			sn[k] = h[(k+1) * m + k] / temp;
+			h[k * m + k] = temp;
+			h[(k+1) * m + k] = 0.0;
+			g[k+1] = -sn[k] * g[k];
+			g[k] = cs[k] * g[k];
+
+			log_printf(DEBUG, "GMRES iteration %d: residual = %e", k,
+											fabs(g[k+1]) / b_norm);
+
+			if (fabs(g[k+1]) / b_norm < _gmres_tolerance) {
+				k++;
+				break;
+			}
+		}
+
+		/* Solve the upper triangular system and update the solution */
+		for (int i = k-1; i >= 0; i--) {
+			for (int j = i+1; j < k; j++)
+				g[i] -= h[i * m + j] * g[j];
+			g[i] /= h[i * m + i];
+		}
+
+		for (int j = 0; j < k; j++) {
+			for (int l = 0; l < size; l++)
+				x[l] += g[j] * v[j][l];
+		}
+	}
+
+	unpackKrylovState(x);
+
+	for (int j = 0; j <= m; j++)
+		delete [] v[j];
+	delete [] v;
+	delete [] h;
+	delete [] cs;
+	delete [] sn;
+	delete [] g;
+	delete [] w;
+	delete [] b;
+
+	return num_sweeps;
+}
+
+
+/**
+ * Computes the fission production rate (nu_sigma_f * flux * volume) in
+ * each FSR from the scalar fluxes in a Krylov state vector
+ * @param x the state vector
+ * @param fission_rates array for the fission production rates
+ */
+void Solver::computeFissionRates(double* x, double* fission_rates) {
+
+	double* nu_sigma_f;
+	Material* material;
+	int start_index, end_index;
+
+	for (int r = 0; r < _num_FSRs; r++) {
+		material = _flat_source_regions[r].getMaterial();
+		nu_sigma_f = material->getNuSigmaF();
+		start_index = material->getNuSigmaFStart();
+		end_index = material->getNuSigmaFEnd();
+
+		fission_rates[r] = 0.0;
+		for (int e = start_index; e < end_index; e++)
+			fission_rates[r] += nu_sigma_f[e] * x[r * NUM_ENERGY_GROUPS + e];
+
+		fission_rates[r] *= _flat_source_regions[r].getVolume();
+	}
+
+	return;
+}
+
+
+/**
+ * Computes k_eff with an explicitly restarted Arnoldi iteration on the
+ * fission source operator, as an alternative to the power iteration in
+ * computeKeff. Each application of the operator solves the fixed source
+ * problem for a fission source with GMRES, using the transport sweep as the
+ * matrix-free operator. If requested, the second eigenvalue (and hence the
+ * dominance ratio) is also converged
+ * @param max_iterations the maximum number of fission operator applications
+ * @return the value of k_eff
+ */
+double Solver::computeKeffArnoldi(int max_iterations) {
+
+	log_printf(NORMAL, "Computing k_eff with Arnoldi iteration...");
+
+	int n = _num_FSRs;
+	int m = _num_arnoldi_vectors;
+	int size = getKrylovStateSize();
+	int num_applications = 0;
+	int num_sweeps = 0;
+	int m_eff, first, second;
+	double temp, h_ij, residual, residual_2;
+	double k_old = 0.0;
+	bool converged = false;
+
+	double** v = new double*[m+1];
+	for (int j = 0; j <= m; j++)
+		v[j] = new double[n];
+	double* h = new double[(m+1) * m];
+	double* hm = new double[m * m];
+	double* wr = new double[m];
+	double* wi = new double[m];
+	double* y = new double[m];
+	double* y_2 = new double[m];
+	double* x = new double[size];
+	double* ritz = new double[n];
+	double* ritz_2 = new double[n];
+
+	/* Check that each FSR has at least one segment crossing it */
+	checkTrackSpacing();
+
+	/* Initial guess is the fission source from a flat flux */
+	oneFSRFluxes();
+	packKrylovState(x);
+	computeFissionRates(x, v[0]);
+
+	while (!converged && num_applications < max_iterations) {
+
+		/* Normalize the starting vector */
+		temp = 0.0;
+		for (int i = 0; i < n; i++)
+			temp += v[0][i] * v[0][i];
+		temp = sqrt(temp);
+		for (int i = 0; i < n; i++)
+			v[0][i] /= temp;
+
+		for (int i = 0; i < (m+1) * m; i++)
+			h[i] = 0.0;
+
+		/* Build the Krylov subspace of the fission source operator */
+		m_eff = m;
+		for (int j = 0; j < m; j++) {
+
+			num_sweeps += solveFixedFissionSource(v[j], x);
+			computeFissionRates(x, v[j+1]);
+			num_applications++;
+
+			for (int i = 0; i <= j; i++) {
+				h_ij = 0.0;
+				for (int l = 0; l < n; l++)
+					h_ij += v[j+1][l] * v[i][l];
+				h[i * m + j] = h_ij;
+				for (int l = 0; l < n; l++)
+					v[j+1][l] -= h_ij * v[i][l];
+			}
 
-		/* Renormalization angular boundary fluxes for each track */
-		#if USE_OPENMP
-		#pragma omp parallel for
-		#endif
-		for (int i = 0; i < _num_azim; i++) {
-			for (int j = 0; j < _num_tracks[i]; j++)
-				_tracks[i][j].normalizeFluxes(renorm_factor);
+			temp = 0.0;
+			for (int l = 0; l < n; l++)
+				temp += v[j+1][l] * v[j+1][l];
+			h[(j+1) * m + j] = sqrt(temp);
+
+			/* Invariant subspace found */
+			if (h[(j+1) * m + j] < 1E-14 * fabs(h[0])) {
+				m_eff = j+1;
+				break;
+			}
+
+			for (int l = 0; l < n; l++)
+				v[j+1][l] /= h[(j+1) * m + j];
 		}
 
+		/* Compute the Ritz values */
+		for (int i = 0; i < m_eff; i++) {
+			for (int j = 0; j < m_eff; j++)
+				hm[i * m_eff + j] = h[i * m + j];
+		}
+		hessenbergEigenvalues(hm, m_eff, wr, wi);
+
+		/* Find the two Ritz values with largest magnitude */
+		first = 0;
+		for (int i = 1; i < m_eff; i++) {
+			if (wr[i]*wr[i] + wi[i]*wi[i] > wr[first]*wr[first] +
+					wi[first]*wi[first])
+				first = i;
+		}
 
-		/*********************************************************************
-		 * Compute the source for each region
-		 *********************************************************************/
+		second = -1;
+		for (int i = 0; i < m_eff; i++) {
+			if (i == first || (wr[i] == wr[first] && wi[i] == -wi[first]))
+				continue;
+			if (second == -1 || wr[i]*wr[i] + wi[i]*wi[i] >
+					wr[second]*wr[second] + wi[second]*wi[second])
+				second = i;
+		}
 
-		/* For all regions, find the source */
-		for (int r = 0; r < _num_FSRs; r++) {
+		_k_eff = wr[first];
+		if (second != -1)
+			_k_eff_2 = sqrt(wr[second]*wr[second] + wi[second]*wi[second]);
 
-			fsr = &_flat_source_regions[r];
-			material = fsr->getMaterial();
+		/* Compute the Ritz vector and its residual norm */
+		for (int i = 0; i < m_eff; i++) {
+			for (int j = 0; j < m_eff; j++)
+				hm[i * m_eff + j] = h[i * m + j];
+		}
+		denseEigenvector(hm, m_eff, wr[first], y);
+		residual = fabs(h[m_eff * m + m_eff - 1] * y[m_eff-1]) / fabs(_k_eff);
+
+		residual_2 = 0.0;
+		if (_compute_second_eigenvalue && second != -1 && wi[second] == 0.0) {
+			denseEigenvector(hm, m_eff, wr[second], y_2);
+			residual_2 = fabs(h[m_eff * m + m_eff - 1] * y_2[m_eff-1])
+															/ fabs(_k_eff_2);
+		}
 
-			/* Initialize the fission source to zero for this region */
-			fission_source = 0;
-			scalar_flux = fsr->getFlux();
-			source = fsr->getSource();
-			material = fsr->getMaterial();
-			nu_sigma_f = material->getNuSigmaF();
-			chi = material->getChi();
-			sigma_s = material->getSigmaS();
+		log_printf(NORMAL, "Arnoldi restart after %d applications: k_eff = "
+				"%f, k_2 = %f, residual = %e", num_applications, _k_eff,
+				_k_eff_2, std::max(residual, residual_2));
+
+		if (fabs(_k_eff - k_old) < KEFF_CONVERG_THRESH &&
+				residual < KEFF_CONVERG_THRESH &&
+				(!_compute_second_eigenvalue ||
+						residual_2 < KEFF_CONVERG_THRESH))
+			converged = true;
+
+		k_old = _k_eff;
+
+		/* Restart with the dominant Ritz vector, plus the second Ritz
+		 * vector if the second eigenvalue is requested */
+		for (int l = 0; l < n; l++) {
+			ritz[l] = 0.0;
+			ritz_2[l] = 0.0;
+			for (int j = 0; j < m_eff; j++) {
+				ritz[l] += v[j][l] * y[j];
+				if (_compute_second_eigenvalue && residual_2 > 0.0)
+					ritz_2[l] += v[j][l] * y_2[j];
+			}
+		}
 
-			start_index = material->getNuSigmaFStart();
-			end_index = material->getNuSigmaFEnd();
+		/* Make the fundamental mode positive */
+		temp = 0.0;
+		for (int l = 0; l < n; l++)
+			temp += ritz[l];
+		if (temp < 0.0) {
+			for (int l = 0; l < n; l++)
+				ritz[l] = -ritz[l];
+		}
 
-			/* Compute total fission source for current region */
-			for (int e = start_index; e < end_index; e++)
-				fission_source += scalar_flux[e] * nu_sigma_f[e];
+		for (int l = 0; l < n; l++)
+			v[0][l] = ritz[l] + ritz_2[l];
+	}
 
-			/* Compute total scattering source for group G */
-			for (int G = 0; G < NUM_ENERGY_GROUPS; G++) {
-				scatter_source = 0;
+	if (!converged)
+		log_printf(WARNING, "Arnoldi iteration did not converge after %d "
+				"fission operator applications", num_applications);
 
-				start_index = material->getSigmaSStart(G);
-				end_index = material->getSigmaSEnd(G);
+	/* Solve for the fluxes of the fundamental mode and normalize them to
+	 * a total fission source of one */
+	num_sweeps += solveFixedFissionSource(ritz, x);
+	computeFissionRates(x, ritz);
 
-				for (int g = start_index; g < end_index; g++)
-					scatter_source += sigma_s[G*NUM_ENERGY_GROUPS + g]
-					                          * scalar_flux[g];
+	temp = 0.0;
+	for (int r = 0; r < n; r++)
+		temp += ritz[r];
 
-				/* Set the total source for region r in group G */
-				source[G] = ((1.0 / (_old_k_effs.front())) * fission_source *
-								chi[G] + scatter_source) * ONE_OVER_FOUR_PI;
+	for (int r = 0; r < _num_FSRs; r++)
+		_flat_source_regions[r].normalizeFluxes(1.0 / temp);
+	for (int i = 0; i < _num_azim; i++) {
+		for (int j = 0; j < _num_tracks[i]; j++)
+			_tracks[i][j].normalizeFluxes(1.0 / temp);
+	}
+
+	log_printf(NORMAL, "Arnoldi iteration used %d fission operator "
+			"applications and %d transport sweeps", num_applications,
+			num_sweeps);
+
+	if (_plotter->plotFlux() == true){
+		/* Load fluxes into FSR to flux map */
+		double flux;
+		for (int r=0; r < _num_FSRs; r++) {
+			_FSRs_to_fluxes[NUM_ENERGY_GROUPS][r] = 0.0;
+			for (int e=0; e < NUM_ENERGY_GROUPS; e++){
+				flux = _scalar_flux[FSR_INDEX(_geom->getInternalFSRId(r), e)];
+				_FSRs_to_fluxes[e][r] = flux;
+				_FSRs_to_fluxes[NUM_ENERGY_GROUPS][r] += flux;
 			}
 		}
+		plotFluxes();
+	}
 
-		/*********************************************************************
-		 * Update flux and check for convergence
-		 *********************************************************************/
+	for (int j = 0; j <= m; j++)
+		delete [] v[j];
+	delete [] v;
+	delete [] h;
+	delete [] hm;
+	delete [] wr;
+	delete [] wi;
+	delete [] y;
+	delete [] y_2;
+	delete [] x;
+	delete [] ritz;
+	delete [] ritz_2;
 
-		/* Update pre-computed source / sigma_t ratios */
-		computeRatios();
+	return _k_eff;
+}
 
-		/* Iteration the flux with the new source */
-		fixedSourceIteration(1);
 
-		/* Update k_eff */
-		updateKeff();
+/**
+ * Sets whether the Arnoldi solver should also converge the second
+ * eigenvalue to report the dominance ratio
+ * @param compute_second_eigenvalue whether to converge the second eigenvalue
+ */
+void Solver::setComputeSecondEigenvalue(bool compute_second_eigenvalue) {
+	_compute_second_eigenvalue = compute_second_eigenvalue;
+}
 
 
-		/* If k_eff converged, return k_eff */
+/**
+ * Returns the second eigenvalue (in magnitude) computed by the Arnoldi solver
+ * @return the second eigenvalue
+ */
+double Solver::getSecondEigenvalue() {
+	return _k_eff_2;
+}
 
-		if (fabs(_old_k_effs.back() - _k_eff) < KEFF_CONVERG_THRESH){
 
-			/* Converge the scalar flux spatially within geometry to plot */
-			fixedSourceIteration(1000);
+/**
+ * Returns the dominance ratio k_2 / k_eff computed by the Arnoldi solver
+ * @return the dominance ratio
+ */
+double Solver::getDominanceRatio() {
+	return _k_eff_2 / _k_eff;
+}
 
-			#if CMFD_ACCEL
-			/* Compute the net currents */
-			fixedSourceIteration(1000, true);
-			_geom->getMesh()->splitCorners();
-			computeXS(_geom->getMesh());
-			if (_plotter->plotCurrent()){
-				//_geom->getMesh()->printCurrents();
-				_plotter->plotNetCurrents(_geom->getMesh());
-				_plotter->plotSurfaceFlux(_geom->getMesh());
-				_plotter->plotXS(_geom->getMesh());
-			}
 
+/**
+ * Rebalances the scalar and track fluxes in energy using a coarse group
+ * structure. The fine group reaction rates are condensed over all FSRs to
+ * a small coarse group eigenvalue problem with no leakage, since all of the
+ * boundaries are reflective. The fine group fluxes in each coarse group are
+ * then scaled by the ratio of the coarse group solution to the condensed
+ * flux, keeping the total fission source unchanged
+ */
+void Solver::coarseEnergyRebalance() {
 
-			#endif
+	int num_coarse = _coarse_group_bounds.size();
+	int coarse_group[NUM_ENERGY_GROUPS];
+	double fission_rates[NUM_ENERGY_GROUPS];
+	double chi_coarse[NUM_ENERGY_GROUPS];
+	double* polar_fluxes;
+	double* sigma_t;
+	double* sigma_s;
+	double* nu_sigma_f;
+	double* chi;
+	double volume;
+	double k_coarse = 1.0;
+	double k_old, norm, new_norm;
+	FlatSourceRegion* fsr;
+	Material* material;
+	int start_index, end_index;
 
-			if (_plotter->plotFlux() == true){
-				/* Load fluxes into FSR to flux map */
-				for (int r=0; r < _num_FSRs; r++) {
-					double* fluxes = _flat_source_regions[r].getFlux();
-					for (int e=0; e < NUM_ENERGY_GROUPS; e++){
-						_FSRs_to_fluxes[e][r] = fluxes[e];
-						_FSRs_to_fluxes[NUM_ENERGY_GROUPS][r] =
-							_FSRs_to_fluxes[NUM_ENERGY_GROUPS][r] + fluxes[e];
-					}
-				}
-				plotFluxes();
+	double* removal = new double[num_coarse * num_coarse];
+	double* production = new double[num_coarse * num_coarse];
+	double* lu = new double[num_coarse * num_coarse];
+	double* factors = new double[num_coarse];
+	double* source = new double[num_coarse];
+	double* total_fission = new double[num_coarse];
+
+	/* Map each fine energy group to its coarse group */
+	for (int K = 0; K < num_coarse; K++) {
+		end_index = (K == num_coarse - 1) ?
+				NUM_ENERGY_GROUPS : _coarse_group_bounds[K+1];
+		for (int g = _coarse_group_bounds[K]; g < end_index; g++)
+			coarse_group[g] = K;
+	}
+
+	for (int i = 0; i < num_coarse * num_coarse; i++) {
+		removal[i] = 0.0;
+		production[i] = 0.0;
+	}
+
+	for (int K = 0; K < num_coarse; K++)
+		total_fission[K] = 0.0;
+
+	/* Condense the fine group reaction rates */
+	for (int r = 0; r < _num_FSRs; r++) {
+		fsr = &_flat_source_regions[r];
+		material = fsr->getMaterial();
+		volume = fsr->getVolume();
+		sigma_t = material->getSigmaT();
+		sigma_s = material->getSigmaS();
+		nu_sigma_f = material->getNuSigmaF();
+		chi = material->getChi();
+
+		for (int K = 0; K < num_coarse; K++) {
+			fission_rates[K] = 0.0;
+			chi_coarse[K] = 0.0;
+		}
+
+		for (int g = 0; g < NUM_ENERGY_GROUPS; g++) {
+			removal[coarse_group[g] * (num_coarse + 1)] += sigma_t[g] *
+													_scalar_flux[FSR_INDEX(r, g)] * volume;
+			fission_rates[coarse_group[g]] += nu_sigma_f[g] * _scalar_flux[FSR_INDEX(r, g)]
+																	* volume;
+			chi_coarse[coarse_group[g]] += chi[g];
+		}
+
+		for (int G = 0; G < NUM_ENERGY_GROUPS; G++) {
+			start_index = material->getSigmaSStart(G);
+			end_index = material->getSigmaSEnd(G);
+
+			for (int g = start_index; g < end_index; g++)
+				removal[coarse_group[G] * num_coarse + coarse_group[g]] -=
+						sigma_s[G*NUM_ENERGY_GROUPS + g] * _scalar_flux[FSR_INDEX(r, g)] * volume;
+		}
+
+		for (int K = 0; K < num_coarse; K++) {
+			total_fission[K] += fission_rates[K];
+			for (int L = 0; L < num_coarse; L++)
+				production[K * num_coarse + L] += chi_coarse[K] *
+															fission_rates[L];
+		}
+	}
+
+	/* Power iteration on the coarse group eigenvalue problem */
+	for (int K = 0; K < num_coarse; K++)
+		factors[K] = 1.0;
+
+	for (int i = 0; i < MAX_ITERATIONS; i++) {
+
+		norm = 0.0;
+		for (int K = 0; K < num_coarse; K++) {
+			source[K] = 0.0;
+			for (int L = 0; L < num_coarse; L++)
+				source[K] += production[K * num_coarse + L] * factors[L];
+			norm += source[K];
+		}
+
+		for (int j = 0; j < num_coarse * num_coarse; j++)
+			lu[j] = removal[j];
+		solveDenseSystem(lu, source, num_coarse);
+
+		new_norm = 0.0;
+		for (int K = 0; K < num_coarse; K++) {
+			for (int L = 0; L < num_coarse; L++)
+				new_norm += production[K * num_coarse + L] * source[L];
+		}
+
+		k_old = k_coarse;
+		k_coarse = new_norm / norm;
+
+		for (int K = 0; K < num_coarse; K++)
+			factors[K] = source[K] / k_coarse;
+
+		if (fabs(k_coarse - k_old) < 1E-10)
+			break;
+	}
+
+	/* Preserve the total fission source */
+	norm = 0.0;
+	new_norm = 0.0;
+	for (int K = 0; K < num_coarse; K++) {
+		norm += total_fission[K];
+		new_norm += total_fission[K] * factors[K];
+	}
+
+	for (int K = 0; K < num_coarse; K++)
+		factors[K] *= norm / new_norm;
+
+	log_printf(INFO, "Coarse energy rebalance: k_coarse = %f", k_coarse);
+
+	/* Prolongate the coarse group correction to the fine group fluxes */
+	#if USE_OPENMP
+	#pragma omp parallel for
+	#endif
+	for (int r = 0; r < _num_FSRs; r++) {
+		for (int g = 0; g < NUM_ENERGY_GROUPS; g++)
+			_scalar_flux[FSR_INDEX(r, g)] *= factors[coarse_group[g]];
+	}
+
+	#if USE_OPENMP
+	#pragma omp parallel for private(polar_fluxes)
+	#endif
+	for (int i = 0; i < _num_azim; i++) {
+		for (int j = 0; j < _num_tracks[i]; j++) {
+			polar_fluxes = _tracks[i][j].getPolarFluxes();
+
+			for (int pe = 0; pe < GRP_TIMES_ANG; pe++) {
+				polar_fluxes[pe] *= factors[coarse_group[pe / NUM_POLAR_ANGLES]];
+				polar_fluxes[GRP_TIMES_ANG + pe] *=
+						factors[coarse_group[pe / NUM_POLAR_ANGLES]];
 			}
+		}
+	}
 
+	delete [] removal;
+	delete [] production;
+	delete [] lu;
+	delete [] factors;
+	delete [] source;
+	delete [] total_fission;
 
-			return _k_eff;
+	return;
+}
+
+
+/**
+ * Sets the coarse energy group structure for the coarse energy rebalance
+ * in computeKeff. Each entry is the first fine energy group of a coarse
+ * group. An empty structure turns off the coarse energy rebalance
+ * @param coarse_group_bounds the first fine group of each coarse group
+ */
+void Solver::setCoarseGroupBounds(std::vector<int> coarse_group_bounds) {
+
+	for (unsigned int K = 0; K < coarse_group_bounds.size(); K++) {
+		if ((K == 0 && coarse_group_bounds[K] != 0) ||
+				(K > 0 && coarse_group_bounds[K] <= coarse_group_bounds[K-1]) ||
+				coarse_group_bounds[K] >= NUM_ENERGY_GROUPS)
+			log_printf(ERROR, "Unable to set the coarse energy groups since "
+					"they must start at group 0 and increase up to %d",
+					NUM_ENERGY_GROUPS - 1);
+	}
+
+	_coarse_group_bounds = coarse_group_bounds;
+}
+
+
+/**
+ * Rebalances the scalar and track fluxes on the CMFD mesh. The outgoing
+ * partial currents across each mesh cell surface are tallied during the
+ * sweep, and the FSR reaction rates are condensed to one energy group in
+ * each mesh cell. A multiplicative factor for each mesh cell is found
+ * which enforces neutron balance in every cell, and is then applied to the
+ * FSR fluxes in the cell and the track fluxes which start in the cell. The
+ * total fission source is preserved
+ */
+void Solver::coarseMeshRebalance() {
+
+#if CMFD_ACCEL
+	Mesh* mesh = _geom->getMesh();
+	int width = mesh->getCellWidth();
+	int height = mesh->getCellHeight();
+	int num_cells = width * height;
+	int row, col, dest_row, dest_col, cell, num_segments;
+	double* polar_fluxes;
+	double* sigma_t;
+	double* sigma_s;
+	double* nu_sigma_f;
+	double volume, current, in_current;
+	double k_mesh = _k_eff > 0.0 ? _k_eff : 1.0;
+	double k_old, norm, new_norm, factor, max_change;
+	FlatSourceRegion* fsr;
+	Material* material;
+	Track* track;
+	std::vector<int>* fsrs;
+	std::vector<int>::iterator iter;
+
+	/* Row and column offsets of the cell across each mesh surface */
+	static const int surface_cols[8] = {-1, 0, 1, 0, -1, 1, 1, -1};
+	static const int surface_rows[8] = {0, 1, 0, -1, 1, 1, -1, -1};
+
+	/* Map each FSR to the mesh cell which contains it */
+	if (_FSRs_to_mesh_cells == NULL) {
+		_FSRs_to_mesh_cells = new int[_num_FSRs];
+
+		for (int i = 0; i < num_cells; i++) {
+			fsrs = mesh->getCells(i)->getFSRs();
+			for (iter = fsrs->begin(); iter != fsrs->end(); ++iter)
+				_FSRs_to_mesh_cells[_geom->getInternalFSRId(*iter)] = i;
 		}
+	}
 
-		/* If not converged, save old k_eff and pop off old_keff from
-		 *  previous iteration */
-		_old_k_effs.push(_k_eff);
-		if (_old_k_effs.size() == NUM_KEFFS_TRACKED)
-			_old_k_effs.pop();
+	double* removal = new double[num_cells];
+	double* fission = new double[num_cells];
+	double* factors = new double[num_cells];
+	int* in_ptr = new int[num_cells + 1];
+	int* in_cells = new int[num_cells * 8];
+	double* in_currents = new double[num_cells * 8];
+	int* dest_cells = new int[num_cells * 8];
+	double* out_currents = new double[num_cells * 8];
+
+	for (int i = 0; i < num_cells; i++) {
+		removal[i] = 0.0;
+		fission[i] = 0.0;
+		factors[i] = 1.0;
+		in_ptr[i] = 0;
+	}
+	in_ptr[num_cells] = 0;
 
-		/* Update sources in each FSR */
-		for (int r = 0; r < _num_FSRs; r++) {
-			fsr = &_flat_source_regions[r];
-			source = fsr->getSource();
-			old_source = fsr->getOldSource();
+	/* Condense the FSR reaction rates to each mesh cell */
+	for (int r = 0; r < _num_FSRs; r++) {
+		fsr = &_flat_source_regions[r];
+		material = fsr->getMaterial();
+		volume = fsr->getVolume();
+		sigma_t = material->getSigmaT();
+		sigma_s = material->getSigmaS();
+		nu_sigma_f = material->getNuSigmaF();
+		cell = _FSRs_to_mesh_cells[r];
+
+		for (int G = 0; G < NUM_ENERGY_GROUPS; G++) {
+			removal[cell] += sigma_t[G] * _scalar_flux[FSR_INDEX(r, G)] * volume;
+			fission[cell] += nu_sigma_f[G] * _scalar_flux[FSR_INDEX(r, G)] * volume;
+
+			for (int g = material->getSigmaSStart(G);
+							g < material->getSigmaSEnd(G); g++)
+				removal[cell] -= sigma_s[G*NUM_ENERGY_GROUPS + g] *
+												_scalar_flux[FSR_INDEX(r, g)] * volume;
+		}
+	}
 
+	/* Find the outgoing partial current across each surface and the cell
+	 * it flows into. Currents out of the geometry are reflected back into
+	 * the same row or column */
+	for (int i = 0; i < num_cells; i++) {
+		row = i / width;
+		col = i % width;
+
+		for (int s = 0; s < 8; s++) {
+			current = 0.0;
 			for (int e = 0; e < NUM_ENERGY_GROUPS; e++)
-				old_source[e] = source[e];
+				current += mesh->getCells(i)->getMeshSurfaces(s)->getFlux(e);
+
+			dest_row = row + surface_rows[s];
+			dest_col = col + surface_cols[s];
+			if (dest_row < 0 || dest_row >= height)
+				dest_row = row;
+			if (dest_col < 0 || dest_col >= width)
+				dest_col = col;
+
+			dest_cells[i * 8 + s] = dest_row * width + dest_col;
+			out_currents[i * 8 + s] = 0.5 * current;
+
+			/* Reflected currents back into the same cell cancel out */
+			if (dest_cells[i * 8 + s] != i) {
+				removal[i] += 0.5 * current;
+				in_ptr[dest_cells[i * 8 + s] + 1]++;
+			}
 		}
 	}
 
-	log_printf(WARNING, "Unable to converge the source after %d iterations",
-															max_iterations);
+	/* Build the list of incoming currents for each cell */
+	for (int i = 0; i < num_cells; i++)
+		in_ptr[i+1] += in_ptr[i];
+
+	for (int i = 0; i < num_cells; i++) {
+		for (int s = 0; s < 8; s++) {
+			cell = dest_cells[i * 8 + s];
+			if (cell != i) {
+				in_cells[in_ptr[cell]] = i;
+				in_currents[in_ptr[cell]] = out_currents[i * 8 + s];
+				in_ptr[cell]++;
+			}
+		}
+	}
 
-	/* Converge the scalar flux spatially within geometry to plot */
-	fixedSourceIteration(1000);
+	for (int i = num_cells; i > 0; i--)
+		in_ptr[i] = in_ptr[i-1];
+	in_ptr[0] = 0;
 
-	if (_plotter->plotFlux() == true){
-		log_printf(NORMAL, "Plotting fluxes...");
-		/* Load fluxes into FSR to flux map */
-		for (int r=0; r < _num_FSRs; r++) {
-			double* fluxes = _flat_source_regions[r].getFlux();
-			for (int e=0; e < NUM_ENERGY_GROUPS; e++){
-				_FSRs_to_fluxes[e][r] = fluxes[e];
-				_FSRs_to_fluxes[NUM_ENERGY_GROUPS][r] =
-						_FSRs_to_fluxes[NUM_ENERGY_GROUPS][r] + fluxes[e];
+	/* Power iteration on the mesh cell balance equations with one
+	 * Gauss-Seidel sweep per iteration */
+	norm = 0.0;
+	for (int i = 0; i < num_cells; i++)
+		norm += fission[i];
+
+	for (int n = 0; n < MAX_ITERATIONS; n++) {
+
+		max_change = 0.0;
+
+		for (int i = 0; i < num_cells; i++) {
+			in_current = 0.0;
+			for (int j = in_ptr[i]; j < in_ptr[i+1]; j++)
+				in_current += factors[in_cells[j]] * in_currents[j];
+
+			factor = (fission[i] * factors[i] / k_mesh + in_current)
+																/ removal[i];
+			max_change = std::max(max_change,
+								fabs(factor - factors[i]) / factor);
+			factors[i] = factor;
+		}
+
+		new_norm = 0.0;
+		for (int i = 0; i < num_cells; i++)
+			new_norm += fission[i] * factors[i];
+
+		k_old = k_mesh;
+		k_mesh *= new_norm / norm;
+		norm = new_norm;
+
+		if (fabs(k_mesh - k_old) < 1E-10 && max_change < 1E-8)
+			break;
+	}
+
+	/* Preserve the total fission source */
+	norm = 0.0;
+	new_norm = 0.0;
+	for (int i = 0; i < num_cells; i++) {
+		norm += fission[i];
+		new_norm += fission[i] * factors[i];
+	}
+
+	for (int i = 0; i < num_cells; i++)
+		factors[i] *= norm / new_norm;
+
+	log_printf(INFO, "Coarse mesh rebalance: k_mesh = %f", k_mesh);
+
+	/* Scale the FSR fluxes and the track fluxes entering each cell */
+	#if USE_OPENMP
+	#pragma omp parallel for private(fsr)
+	#endif
+	for (int r = 0; r < _num_FSRs; r++) {
+		fsr = &_flat_source_regions[r];
+		fsr->normalizeFluxes(factors[_FSRs_to_mesh_cells[r]]);
+	}
+
+	#if USE_OPENMP
+	#pragma omp parallel for private(track, polar_fluxes, num_segments)
+	#endif
+	for (int i = 0; i < _num_azim; i++) {
+		for (int j = 0; j < _num_tracks[i]; j++) {
+			track = &_tracks[i][j];
+			polar_fluxes = track->getPolarFluxes();
+			num_segments = track->getNumSegments();
+
+			for (int pe = 0; pe < GRP_TIMES_ANG; pe++) {
+				polar_fluxes[pe] *= factors[_FSRs_to_mesh_cells[
+									track->getSegment(0)->_region_id]];
+				polar_fluxes[GRP_TIMES_ANG + pe] *= factors[_FSRs_to_mesh_cells[
+						track->getSegment(num_segments-1)->_region_id]];
 			}
 		}
-		plotFluxes();
 	}
 
+	delete [] removal;
+	delete [] fission;
+	delete [] factors;
+	delete [] in_ptr;
+	delete [] in_cells;
+	delete [] in_currents;
+	delete [] dest_cells;
+	delete [] out_currents;
+#endif
 
+	return;
+}
 
 
+/**
+ * Sets whether or not to rebalance the fluxes on the CMFD mesh after each
+ * sweep in computeKeff. This requires CMFD_ACCEL to be set so that the
+ * mesh surfaces are tallied during the sweep
+ * @param coarse_mesh_rebalance whether or not to use coarse mesh rebalance
+ */
+void Solver::setCoarseMeshRebalance(bool coarse_mesh_rebalance) {
 
+#if !CMFD_ACCEL
+	if (coarse_mesh_rebalance) {
+		log_printf(WARNING, "Coarse mesh rebalance requires CMFD_ACCEL to "
+				"be set in configurations.h and will not be used");
+		coarse_mesh_rebalance = false;
+	}
+#endif
 
-	return _k_eff;
+	_coarse_mesh_rebalance = coarse_mesh_rebalance;
 }
 
 
@@ -1117,7 +4407,7 @@ void Solver::cmfd() {
 /* FIXME */
 void Solver::computeNetCurrent() {
 	double scatter_source, fission_source, volume;
-	double *nu_sigma_f, *scalar_flux, *sigma_s, *chi, *source;
+	double *nu_sigma_f, *sigma_s, *chi;
 	FlatSourceRegion* fsr;
 	Material* material;
 	int start_index, end_index;
@@ -1134,9 +4424,7 @@ void Solver::computeNetCurrent() {
 		fsr = &_flat_source_regions[r];
 		material = fsr->getMaterial();
 		nu_sigma_f = material->getNuSigmaF();
-		scalar_flux = fsr->getFlux();
 		volume = fsr->getVolume();
-		source = fsr->getSource();
 		chi = material->getChi();
 		sigma_s = material->getSigmaS();
 
@@ -1145,7 +4433,7 @@ void Solver::computeNetCurrent() {
 		end_index = fsr->getMaterial()->getNuSigmaFEnd();
 		fission_source = 0;
 		for (int e = start_index; e < end_index; e++)
-			fission_source += nu_sigma_f[e] * scalar_flux[e] * volume;
+			fission_source += nu_sigma_f[e] * _scalar_flux[FSR_INDEX(r, e)] * volume;
 
 		/* compute scattering source */
 		for (int G = 0; G < NUM_ENERGY_GROUPS; G++) {
@@ -1154,9 +4442,9 @@ void Solver::computeNetCurrent() {
 			end_index = material->getSigmaSEnd(G);
 			for (int g = start_index; g < end_index; g++)
 				scatter_source += sigma_s[G*NUM_ENERGY_GROUPS + g]
-					* scalar_flux[g];
+					* _scalar_flux[FSR_INDEX(r, g)];
 			/* Set the total source for region r in group G */
-			source[G] = ((1.0 / (_old_k_effs.front())) * fission_source *
+			_source[FSR_INDEX(r, G)] = ((1.0 / (_old_k_effs.front())) * fission_source *
 						 chi[G] + scatter_source) * ONE_OVER_FOUR_PI;
 		}
 
@@ -1166,7 +4454,7 @@ void Solver::computeNetCurrent() {
 /* FIXME */
 void Solver::computeCoeffs() {
 	double scatter_source, fission_source, volume;
-	double *nu_sigma_f, *scalar_flux, *chi, *source, *sigma_s, *sigma_a;
+	double *nu_sigma_f, *chi, *sigma_s, *sigma_a;
 	FlatSourceRegion* fsr;
 	Material* material;
 	int start_index, end_index;
@@ -1183,16 +4471,14 @@ void Solver::computeCoeffs() {
 		fsr = &_flat_source_regions[r];
 		material = fsr->getMaterial();
 		nu_sigma_f = material->getNuSigmaF();
-		scalar_flux = fsr->getFlux();
 		volume = fsr->getVolume();
-		source = fsr->getSource();
 		chi = material->getChi();
 		sigma_s = material->getSigmaS();
 
 		/* compute absorption cross section */
 		sigma_a = material->getSigmaA();
 		for (int e = 0; e <= NUM_ENERGY_GROUPS; e++) {
-			_FSRs_to_absorption[e][r] = sigma_a[e];
+			_FSRs_to_absorption[e][_geom->getExternalFSRId(r)] = sigma_a[e];
 		}
 
 		/* compute fission source */
@@ -1200,7 +4486,7 @@ void Solver::computeCoeffs() {
 		end_index = fsr->getMaterial()->getNuSigmaFEnd();
 		fission_source = 0;
 		for (int e = start_index; e < end_index; e++)
-			fission_source += nu_sigma_f[e] * scalar_flux[e] * volume;
+			fission_source += nu_sigma_f[e] * _scalar_flux[FSR_INDEX(r, e)] * volume;
 		//_FSRs_to_fission_source[r] = fission_source;
 
 		/* comptue scattering source */
@@ -1210,7 +4496,7 @@ void Solver::computeCoeffs() {
 			end_index = material->getSigmaSEnd(G);
 			for (int g = start_index; g < end_index; g++) {
 				scatter_source += sigma_s[G*NUM_ENERGY_GROUPS + g]
-					* scalar_flux[g];
+					* _scalar_flux[FSR_INDEX(r, g)];
 			}
 			//_FSRs_to_scatter_source[r] = scatter_source * volume;
 
@@ -1271,7 +4557,7 @@ void Solver::computeXS(Mesh* mesh){
 
 		std::vector<int>::iterator iter;
 		for (iter = meshCell->getFSRs()->begin(); iter != meshCell->getFSRs()->end(); ++iter) {
-			fsr = &_flat_source_regions[*iter];
+			fsr = &_flat_source_regions[_geom->getInternalFSRId(*iter)];
 			material = fsr->getMaterial();
 			volume = fsr->getVolume();
 			abs_tally_fsr = 0;
@@ -1281,7 +4567,8 @@ void Solver::computeXS(Mesh* mesh){
 			nu_fis_tally_fsr = 0;
 
 			for (int e = 0; e < NUM_ENERGY_GROUPS; e++){
-				flux = fsr->getFlux()[e];
+				flux = _scalar_flux[FSR_INDEX(_geom->getInternalFSRId(*iter),
+																e)];
 				abs = material->getSigmaA()[e];
 				tot = material->getSigmaT()[e];
 				fis = material->getSigmaF()[e];
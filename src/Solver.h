@@ -17,6 +17,9 @@
 #include <string>
 #include <sstream>
 #include <queue>
+#include <vector>
+#include <map>
+#include <algorithm>
 #include "Geometry.h"
 #include "Quadrature.h"
 #include "Track.h"
@@ -28,18 +31,51 @@
 #include "Mesh.h"
 #include "MeshCell.h"
 #include "Material.h"
+#include "SegmentDatabase.h"
 
 #if USE_OPENMP == true
 	#include <omp.h>
 #endif
 
+/* Index of energy group e of FSR r in the solver's FSR arrays */
+#if FSR_MAJOR
+	#define FSR_INDEX(r, e) ((r) * NUM_ENERGY_GROUPS + (e))
+#else
+	#define FSR_INDEX(r, e) ((e) * _num_FSRs + (r))
+#endif
+
+/* Norms over the FSRs for the fission source residual */
+enum residualNorm {
+	L2_NORM,
+	LINF_NORM
+};
+
 class Solver {
 private:
 	Geometry* _geom;
 	Quadrature* _quad;
 	FlatSourceRegion* _flat_source_regions;
+	/* Scalar fluxes, sources and source / sigma_t ratios for all FSRs and
+	 * energy groups, indexed by FSR_INDEX */
+	double* _scalar_flux;
+	double* _old_scalar_flux;
+	double* _source;
+	double* _old_source;
+	double* _ratios;
+#if USE_OPENMP
+	omp_lock_t* _FSR_locks;
+#endif
+	TrackGenerator* _track_generator;
 	Track** _tracks;
 	int* _num_tracks;
+	/* Read-only segments shared with other processes, or NULL if the
+	 * tracks hold their own segments */
+	SegmentDatabase* _segment_database;
+#if USE_MPI
+	/* Subdomain of this process, whose FSR fluxes are added up with those
+	 * of the other subdomains after each sweep, or NULL if it has them all */
+	DomainDecomposition* _domain;
+#endif
 	int _num_azim;
 	int _num_FSRs;
 	double *_FSRs_to_fluxes[NUM_ENERGY_GROUPS + 1];
@@ -51,17 +87,118 @@ private:
 	double *_FSRs_to_pin_absorption[NUM_ENERGY_GROUPS + 1];
 	double _k_eff;
 	std::queue<double> _old_k_effs;
+	/* Arnoldi eigenvalue solver: second eigenvalue, Krylov subspace sizes
+	 * and tolerance for the fixed fission source solves */
+	bool _compute_second_eigenvalue;
+	double _k_eff_2;
+	int _num_arnoldi_vectors;
+	int _num_gmres_vectors;
+	double _gmres_tolerance;
+	int _num_polar_fluxes;
+	/* Gauss-Seidel iteration in energy with upscatter sub-iterations */
+	bool _energy_gauss_seidel;
+	int _num_upscatter_iterations;
+	/* Drop converged energy groups from multi-sweep fixed source solves */
+	bool _skip_converged_groups;
+	/* Stopping criteria for the source iteration; a source or flux
+	 * tolerance of zero turns that criterion off */
+	double _keff_tolerance;
+	double _source_tolerance;
+	residualNorm _source_norm;
+	double _flux_tolerance;
+	double* _old_fission_source_dist;
+	/* Binary checkpoint of the solver state for restarts */
+	std::string _checkpoint_file;
+	int _checkpoint_interval;
+	std::string _restart_file;
+	/* Start each solve from the previous solution */
+	bool _warm_start;
+	int _num_iterations;
+	/* First fine energy group of each coarse group for energy rebalance */
+	std::vector<int> _coarse_group_bounds;
+	/* Coarse mesh rebalance on the CMFD mesh */
+	bool _coarse_mesh_rebalance;
+	int* _FSRs_to_mesh_cells;
+	/* FSR ids grouped by material, with bucket b holding the FSRs
+	 * _material_bucket_FSRs[_material_bucket_offsets[b]] up to the next
+	 * offset, which are all filled by _material_buckets[b] */
+	int _num_material_buckets;
+	Material** _material_buckets;
+	int* _material_bucket_offsets;
+	int* _material_bucket_FSRs;
+#if STORE_PREFACTORS
+	/* Segments grouped by material bucket in the same way as the FSRs */
+	segment** _material_bucket_segments;
+	int* _material_bucket_segment_offsets;
+#endif
+	/* Batched solve of several cross-section sets, with the case index
+	 * innermost in each array and the active cases in the first slots */
+	int _batch_size;
+	double* _batch_sigma_t;
+	double* _batch_sigma_a;
+	double* _batch_nu_sigma_f;
+	double* _batch_chi;
+	double* _batch_sigma_s;
+	double* _batch_scalar_flux;
+	double* _batch_ratios;
+	double* _batch_polar_fluxes;
+	double* _batch_k_eff;
+	double* _batch_old_k_eff;
+	int* _batch_cases;
+	std::vector<int> _batch_num_iterations;
+	int* _FSR_buckets;
+	int* _track_offsets;
+	int* _batch_tracks_out;
+	int* _batch_tracks_in;
 	Plotter* _plotter;
 	float* _pix_map_total_flux;
-#if !STORE_PREFACTORS
+	/* Linear interpolation table of the exponential pre-factors, used in
+	 * the sweeps if they are not stored in the segments and in batched
+	 * solves */
 	double* _pre_factor_array;
 	int _pre_factor_array_size;
 	int _pre_factor_max_index;
 	double _pre_factor_spacing;
-#endif
 	void precomputeFactors();
+	void initializePreFactorArray();
 	double computePreFactor(segment* seg, int energy, int angle);
 	void initializeFSRs();
+	void initializeMaterialBuckets();
+	void attenuateFluxes(segment* seg, double* polar_fluxes, double* weights,
+						int* groups, int num_groups, double* fsr_flux);
+#if CMFD_ACCEL
+	void tallyMeshSurface(MeshSurface* mesh_surface, double* polar_fluxes,
+						double* weights, double phi, int* groups,
+						int num_groups);
+#endif
+	void sweepTrack(Track* track, int* groups, int num_groups, bool cmfd);
+	void sweepTrackDirection(Track* track, bool reverse, int* groups,
+										int num_groups, bool cmfd);
+	void sweepTrackSegments(int* groups, int num_groups, bool cmfd);
+	void sweepSharedSegments(int* groups, int num_groups);
+	void sweepTiles(int* groups, int num_groups, bool cmfd);
+	void sweepChains(int* groups, int num_groups, bool cmfd);
+	int getKrylovStateSize();
+	void packKrylovState(double* x);
+	void unpackKrylovState(double* x);
+	void krylovScatterSweep(double* x, double* y);
+	int solveFixedFissionSource(double* fission_rates, double* x);
+	void computeFissionRates(double* x, double* fission_rates);
+	void updateSources(double renorm_factor);
+	int computeUpscatterStart();
+	void computeGroupSources(int group_start, int group_end);
+	double energyGaussSeidelSweep(int upscatter_start);
+	double computeSourceResidual();
+	void writeCheckpoint(int iteration);
+	int readCheckpoint();
+	void coarseEnergyRebalance();
+	void initializeBatch(std::vector<std::map<int, Material*> >
+														case_materials);
+	void deleteBatch();
+	int getTrackIndex(Track* track);
+	void swapBatchCases(int a, int b);
+	void batchTransportSweep(int num_cases);
+	void coarseMeshRebalance();
 public:
 	Solver(Geometry* geom, TrackGenerator* track_generator, Plotter* plotter);
 	virtual ~Solver();
@@ -71,8 +208,36 @@ public:
 	void computeRatios();
 	void updateKeff();
 	double** getFSRtoFluxMap();
-	void fixedSourceIteration(int max_iterations, bool cmfd);
+	double transportSweep(int* groups, int num_groups, bool cmfd,
+										double* group_residuals);
+	double transportSweep(int group_start, int group_end, bool cmfd);
+	double fixedSourceIteration(int max_iterations, bool cmfd);
 	double computeKeff(int max_iterations);
+	void setEnergyGaussSeidel(bool energy_gauss_seidel);
+	void setNumUpscatterIterations(int num_upscatter_iterations);
+	void setSkipConvergedGroups(bool skip_converged_groups);
+	void setKeffTolerance(double keff_tolerance);
+	void setSourceTolerance(double source_tolerance,
+										residualNorm source_norm);
+	void setFluxTolerance(double flux_tolerance);
+	void setCheckpointFile(std::string checkpoint_file,
+											int checkpoint_interval);
+	void setRestartFile(std::string restart_file);
+	void setWarmStart(bool warm_start);
+	int getNumIterations();
+	void updateMaterials(std::vector<Material*> materials);
+	bool swapLatticeUniverse(int lattice_id, int lattice_x, int lattice_y,
+												int universe_id);
+	void setCoarseGroupBounds(std::vector<int> coarse_group_bounds);
+	void setCoarseMeshRebalance(bool coarse_mesh_rebalance);
+	double computeKeffArnoldi(int max_iterations);
+	std::vector<double> computeKeffBatch(std::vector<std::map<int,
+							Material*> > case_materials, int max_iterations);
+	std::vector<int> getBatchNumIterations();
+	bool writeScalarFluxes(const char* output_file);
+	void setComputeSecondEigenvalue(bool compute_second_eigenvalue);
+	double getSecondEigenvalue();
+	double getDominanceRatio();
 	void plotFluxes();
 	void checkTrackSpacing();
 	void computePinPowers();
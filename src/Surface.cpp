@@ -698,20 +698,7 @@ Cruciform::Cruciform(const int id, const boundaryType boundary,
     rotation = _rotation;
 }
 
-Cruciform::~Cruciform() {
-
-#ifdef CRUCIMEMOIZE
-    // Delete our memoized intersection map
-    unordered_map<long, vector<Point*>* >::iterator it;
-    int j;
-    for(it=memintersections.begin(); it!=memintersections.end(); ++it)
-    {
-        for(j=0; j<(int)it->second->size(); j++)
-            delete it->second->at(j);
-        delete it->second;
-    }
-#endif
-}
+Cruciform::~Cruciform() { }
 
 double resqrt(double x) {
     return x >= 0 ? sqrt(x) : 0;
@@ -747,7 +734,8 @@ double Cruciform::cruci(double px, double py, double rot) {
 }
 
 
-Point* Cruciform::scalarsecant(double x_n, double x_nm1, Point* initial, double angle) {
+bool Cruciform::scalarsecant(double x_n, double x_nm1, Point* initial,
+                             double angle, Point* result) {
     double x0 = (initial->getX() - x) / scale;
     double y0 = (initial->getY() - y) / scale;
     double delx = cos(angle);
@@ -766,15 +754,17 @@ Point* Cruciform::scalarsecant(double x_n, double x_nm1, Point* initial, double
 
     for(int iters=0; iters<max_iterations; iters++) {
         if(y_n == y_nm1)
-            return (Point*)0;
+            return false;
         dx = y_n * (x_n - x_nm1) / (y_n - y_nm1);
         if(abs(y_n) < EPSILON && abs(x_n - x_nm1) < EPSILON) {
-            if(x_n < 2 && x_n > 0)
-                return new Point(
+            if(x_n < 2 && x_n > 0) {
+                result->setCoords(
                     x + scale * (x_n * delx + x0),
                     y + scale * (x_n * dely + y0));
+                return true;
+            }
             else
-                return (Point*)0;
+                return false;
         }
         x_nm1 = x_n;
         x_n = x_n - dx;
@@ -782,7 +772,7 @@ Point* Cruciform::scalarsecant(double x_n, double x_nm1, Point* initial, double
         y_n = cruci(x_n * delx + x0, x_n * dely + y0, rotation);
     }
 
-    return (Point*)0;
+    return false;
 }
 
 // See if any of the approximations of previous points match
@@ -807,16 +797,19 @@ long hash_point_angle(Point* point, double angle) {
 int Cruciform::intersection(Point* point, double angle, Point* points) {
     double xn, xnm1;
     long curhash;
-    Point* cur;
-    vector<Point*>* intersections = new vector<Point*>();
+    Point cur;
+    vector<Point> found;
+    vector<Point>* intersections = &found;
     int num = 0;
 
     unordered_set<long> matches;
     long curargs = hash_point_angle(point, angle);
 
 #ifdef CRUCIMEMOIZE
-    if(memintersections[curargs]) {
-        intersections = memintersections[curargs];
+    unordered_map<long, vector<Point> >::iterator it =
+        memintersections.find(curargs);
+    if(it != memintersections.end()) {
+        intersections = &it->second;
     } else {
 #endif
         matches.insert(curargs);
@@ -825,23 +818,20 @@ int Cruciform::intersection(Point* point, double angle, Point* points) {
         {
             xn = xx - 0.05;
             xnm1 = xx + 0.05;
-            cur = scalarsecant(xn, xnm1, point, angle);
 
-            if(!cur)
+            if(!scalarsecant(xn, xnm1, point, angle, &cur))
                 continue;
 
-            curhash = hash_point_angle(cur, angle);
+            curhash = hash_point_angle(&cur, angle);
 
-            if (matches.count(curhash)) {
-                delete cur;
+            if (matches.count(curhash))
                 continue;
-            }
 
             matches.insert(curhash);
             intersections->push_back(cur);
         }
 #ifdef CRUCIMEMOIZE
-        memintersections[curargs] = intersections;
+        intersections = &(memintersections[curargs] = found);
     }
 #endif
 
@@ -850,8 +840,8 @@ int Cruciform::intersection(Point* point, double angle, Point* points) {
     int mnum = min(2, (int)intersections->size());
     
     for(num=0; num < mnum; num++) 
-        points[num].setCoords(intersections->at(num)->getX(),
-            intersections->at(num)->getY());
+        points[num].setCoords(intersections->at(num).getX(),
+            intersections->at(num).getY());
     return mnum;
 }
 
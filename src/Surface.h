@@ -176,7 +176,7 @@ private:
 	double scale;
     double rotation;
 #ifdef CRUCIMEMOIZE
-    unordered_map<long, vector<Point*>* > memintersections;
+    unordered_map<long, vector<Point> > memintersections;
 #endif
 	friend class Surface;
 	friend class Plane;
@@ -186,7 +186,8 @@ public:
     ~Cruciform();
 	double evaluate(const Point* point) const;
     static double cruci(double px, double py, double rot);
-    Point* scalarsecant(double x_n, double x_nm1, Point* initial, double angle);
+    bool scalarsecant(double x_n, double x_nm1, Point* initial, double angle,
+                      Point* result);
 	int intersection(Point* point, double angle, Point* points);
 	string toString();
 
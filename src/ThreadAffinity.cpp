@@ -0,0 +1,171 @@
+/*
+ * ThreadAffinity.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *
+ *  Pins the OpenMP threads to the CPUs of one or more sockets, so that the
+ *  data each thread touches first is allocated on its own socket
+ *
+ */
+
+#include "ThreadAffinity.h"
+
+
+/**
+ * ThreadAffinity constructor finds the CPUs this process may run on and
+ * the socket each one belongs to. The sockets are numbered from zero in
+ * the order of their physical ids
+ */
+ThreadAffinity::ThreadAffinity() {
+
+	_num_sockets = 0;
+
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+
+	if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (CPU_ISSET(cpu, &set)) {
+				_cpus.push_back(cpu);
+				_sockets.push_back(readSocket(cpu));
+			}
+		}
+	}
+#endif
+
+	std::map<int, int> socket_ids;
+	for (unsigned int i = 0; i < _sockets.size(); i++)
+		socket_ids[_sockets[i]] = 0;
+
+	std::map<int, int>::iterator iter;
+	for (iter = socket_ids.begin(); iter != socket_ids.end(); ++iter)
+		iter->second = _num_sockets++;
+
+	for (unsigned int i = 0; i < _sockets.size(); i++)
+		_sockets[i] = socket_ids[_sockets[i]];
+}
+
+
+/**
+ * ThreadAffinity destructor
+ */
+ThreadAffinity::~ThreadAffinity() { }
+
+
+/**
+ * Reads the physical id of the socket of a CPU from sysfs
+ * @param cpu the CPU
+ * @return the socket's physical id, or 0 if it is not known
+ */
+int ThreadAffinity::readSocket(int cpu) {
+
+	char path[FILENAME_MAX];
+	int socket = 0;
+
+	snprintf(path, FILENAME_MAX, "/sys/devices/system/cpu/cpu%d/topology/"
+										"physical_package_id", cpu);
+
+	FILE* file = fopen(path, "r");
+	if (file == NULL)
+		return 0;
+
+	if (fscanf(file, "%d", &socket) != 1 || socket < 0)
+		socket = 0;
+	fclose(file);
+
+	return socket;
+}
+
+
+/**
+ * Returns the number of sockets with CPUs this process may run on
+ * @return the number of sockets
+ */
+int ThreadAffinity::getNumSockets() const {
+	return _num_sockets;
+}
+
+
+/**
+ * Pins each OpenMP thread to one CPU of the first sockets. In the compact
+ * layout consecutive threads fill the CPUs of one socket before the next,
+ * and in the scatter layout they are dealt out to the sockets in turn. The
+ * default number of threads is set to the number of CPUs used, and if a
+ * team is larger than that its threads share the CPUs in the same order.
+ * This must be called before the data which is to be local to the threads
+ * is allocated
+ * @param num_threads the size of the largest team which will be started
+ * @param num_sockets the number of sockets to use, or 0 for all of them
+ * @param scatter whether to deal the threads out to the sockets in turn
+ */
+void ThreadAffinity::pin(int num_threads, int num_sockets, bool scatter) {
+
+	if (_cpus.empty()) {
+		log_printf(WARNING, "Unable to find the CPUs of this process, the "
+										"threads will not be pinned");
+		return;
+	}
+
+	if (num_sockets <= 0)
+		num_sockets = _num_sockets;
+	else if (num_sockets > _num_sockets) {
+		log_printf(WARNING, "Only %d sockets are available to pin the "
+							"threads to", _num_sockets);
+		num_sockets = _num_sockets;
+	}
+
+	/* List the CPUs of each socket in use */
+	std::vector<std::vector<int> > socket_cpus(num_sockets);
+	for (unsigned int i = 0; i < _cpus.size(); i++) {
+		if (_sockets[i] < num_sockets)
+			socket_cpus[_sockets[i]].push_back(_cpus[i]);
+	}
+
+	/* Order the CPUs in which the threads are pinned to them */
+	std::vector<int> order;
+	unsigned int max_cpus = 0;
+
+	for (int s = 0; s < num_sockets; s++)
+		max_cpus = std::max(max_cpus, (unsigned int)socket_cpus[s].size());
+
+	if (scatter) {
+		for (unsigned int i = 0; i < max_cpus; i++) {
+			for (int s = 0; s < num_sockets; s++) {
+				if (i < socket_cpus[s].size())
+					order.push_back(socket_cpus[s][i]);
+			}
+		}
+	}
+	else {
+		for (int s = 0; s < num_sockets; s++)
+			order.insert(order.end(), socket_cpus[s].begin(),
+										socket_cpus[s].end());
+	}
+
+	int num_cpus = order.size();
+
+#ifdef __linux__
+#if USE_OPENMP
+	omp_set_num_threads(num_cpus);
+
+	/* Pin the pool of threads which later teams reuse */
+	#pragma omp parallel num_threads(std::max(num_threads, num_cpus))
+	{
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(order[omp_get_thread_num() % num_cpus], &set);
+		sched_setaffinity(0, sizeof(set), &set);
+	}
+#else
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(order[0], &set);
+	sched_setaffinity(0, sizeof(set), &set);
+#endif
+#endif
+
+	log_printf(NORMAL, "Pinned the threads to %d CPUs on %d of %d sockets "
+			"in a %s layout", num_cpus, num_sockets, _num_sockets,
+			scatter ? "scatter" : "compact");
+}
@@ -0,0 +1,40 @@
+/*
+ * ThreadAffinity.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ *  Pins the OpenMP threads to the CPUs of one or more sockets, so that the
+ *  data each thread touches first is allocated on its own socket
+ *
+ */
+
+#ifndef THREADAFFINITY_H_
+#define THREADAFFINITY_H_
+
+#include <sched.h>
+#include <stdio.h>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "log.h"
+#include "configurations.h"
+
+#if USE_OPENMP
+	#include <omp.h>
+#endif
+
+class ThreadAffinity {
+private:
+	/* The CPUs this process may run on and the socket of each one */
+	std::vector<int> _cpus;
+	std::vector<int> _sockets;
+	int _num_sockets;
+	int readSocket(int cpu);
+public:
+	ThreadAffinity();
+	virtual ~ThreadAffinity();
+	int getNumSockets() const;
+	void pin(int num_threads, int num_sockets, bool scatter);
+};
+
+#endif /* THREADAFFINITY_H_ */
@@ -96,6 +96,38 @@ void Track::setPolarFluxes(bool direction, int start_index,
 }
 
 
+/**
+ * Set this track's polar fluxes for a particular direction (0 or 1) for
+ * a list of energy groups only. The fluxes for the remaining energy
+ * groups are left unchanged
+ * @param direction incoming/outgoing (0/1) flux for forward/reverse directions
+ * @param polar_fluxes pointer to an array of fluxes
+ * @param groups the energy groups to set
+ * @param num_groups the number of energy groups in the list
+ */
+void Track::setPolarFluxes(bool direction, int start_index,
+				double* polar_fluxes, int* groups, int num_groups) {
+#if USE_OPENMP
+	omp_set_lock(&_flux_lock);
+#endif
+
+	int start = direction * GRP_TIMES_ANG;
+	int i;
+
+	for (int g = 0; g < num_groups; g++) {
+		i = groups[g] * NUM_POLAR_ANGLES;
+		for (int p = 0; p < NUM_POLAR_ANGLES; p++, i++)
+			_polar_fluxes[start + i] = polar_fluxes[i+start_index];
+	}
+
+#if USE_OPENMP
+	omp_unset_lock(&_flux_lock);
+#endif
+
+	return;
+}
+
+
 /*
  * Set the track azimuthal angle
  * @param phi the azimuthal angle
@@ -361,16 +393,27 @@ bool Track::contains(Point* point) {
 
 
 /**
- * Deletes each of this track's segments
+ * Removes each of this track's segments. Their memory belongs to the
+ * arena they were allocated from and is freed when it is released
  */
 void Track::clearSegments() {
-	for (int i=0; i < (int)_segments.size(); i++)
-		delete _segments.at(i);
-
 	_segments.clear();
 }
 
 
+/**
+ * Replaces each of this track's segments with a copy allocated from an
+ * arena of the calling thread and first written by it, so that the
+ * segments are stored on the memory of the socket the thread runs on
+ * @param arena the arena to allocate the copies from
+ */
+void Track::reallocateSegments(Arena* arena) {
+	for (int i=0; i < (int)_segments.size(); i++)
+		_segments.at(i) = new (arena->allocate(sizeof(segment)))
+										segment(*_segments.at(i));
+}
+
+
 /**
  * Convert this track's attributes to a character array
  * @return a character array of this track's attributes
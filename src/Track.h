@@ -13,11 +13,13 @@
 #include <vector>
 #include <stdlib.h>
 #include <string>
+#include <new>
 #include "Point.h"
 #include "Material.h"
 #include "log.h"
 #include "configurations.h"
 #include "MeshSurface.h"
+#include "Arena.h"
 
 #if USE_OPENMP
 	#include <omp.h>
@@ -59,6 +61,8 @@ public:
     void setAzimuthalWeight(const double azim_weight);
     void setPolarWeight(const int angle, double polar_weight);
     void setPolarFluxes(bool direction, int start_index, double* polar_fluxes);
+    void setPolarFluxes(bool direction, int start_index, double* polar_fluxes,
+    					int* groups, int num_groups);
     void setPhi(const double phi);
     void setReflIn(const bool refl_in);
     void setReflOut(const bool refl_out);
@@ -83,6 +87,7 @@ public:
     bool contains(Point* point);
 	void addSegment(segment* segment);
 	void clearSegments();
+	void reallocateSegments(Arena* arena);
 	std::string toString();
 };
 
@@ -8,6 +8,7 @@
  */
 
 #include "TrackGenerator.h"
+#include "FlatSourceRegion.h"
 
 
 /**
@@ -24,6 +25,13 @@ TrackGenerator::TrackGenerator(Geometry* geom, Plotter* plotter,
 	_geom = geom;
 	_num_azim = num_azim/2.0;
 	_spacing = spacing;
+	_segment_database = NULL;
+#if USE_MPI
+	_domain = NULL;
+#endif
+	_num_tiles = 1;
+	_tile_offsets = NULL;
+	_huge_pages = false;
 
 	try {
 		_num_tracks = new int[_num_azim];
@@ -52,6 +60,23 @@ TrackGenerator::~TrackGenerator() {
 		delete [] _tracks[i];
 
 	delete [] _tracks;
+
+	if (_segment_database != NULL)
+		delete _segment_database;
+
+#if USE_MPI
+	if (_domain != NULL)
+		delete _domain;
+#endif
+
+	if (_tile_offsets != NULL)
+		delete [] _tile_offsets;
+
+	for (unsigned int i = 0; i < _tile_fluxes.size(); i++)
+		delete _tile_fluxes[i]._ghost;
+
+	for (unsigned int i = 0; i < _segment_arenas.size(); i++)
+		delete _segment_arenas[i];
 }
 
 
@@ -100,6 +125,76 @@ Track **TrackGenerator::getTracks() const {
 }
 
 
+/**
+ * Return the shared segment database, or NULL if the tracks hold their
+ * own segments
+ * @return a pointer to the segment database
+ */
+SegmentDatabase* TrackGenerator::getSegmentDatabase() const {
+    return _segment_database;
+}
+
+
+#if USE_MPI
+/**
+ * Return the subdomain of this process, or NULL if the tracks have not
+ * been decomposed
+ * @return a pointer to the domain decomposition
+ */
+DomainDecomposition* TrackGenerator::getDomainDecomposition() const {
+    return _domain;
+}
+#endif
+
+
+/**
+ * Returns the number of tiles the track pieces are swept in
+ * @return the number of tiles, which is one if the tracks are not tiled
+ */
+int TrackGenerator::getNumTiles() const {
+	return _num_tiles;
+}
+
+
+/**
+ * Returns the index of the first track piece in each tile for each
+ * azimuthal angle. The pieces of tile t at angle i run from
+ * offsets[i * (num_tiles + 1) + t] up to offsets[i * (num_tiles + 1) + t + 1]
+ * @return the tile offsets, or NULL if the tracks are not tiled
+ */
+int* TrackGenerator::getTileOffsets() const {
+	return _tile_offsets;
+}
+
+
+/**
+ * Returns the number of chains of track directions
+ * @return the number of chains, which is zero if they have not been made
+ */
+int TrackGenerator::getNumChains() const {
+	return (int)_chain_offsets.size() - 1;
+}
+
+
+/**
+ * Returns the track directions of all chains, one chain after another
+ * @return the chain links
+ */
+const chain_link* TrackGenerator::getChainLinks() const {
+	return &_chain_links[0];
+}
+
+
+/**
+ * Returns the index of the first link of each chain. The links of chain c
+ * run from offsets[c] up to offsets[c + 1]
+ * @return the chain offsets
+ */
+const int* TrackGenerator::getChainOffsets() const {
+	return &_chain_offsets[0];
+}
+
+
 /**
  * Computes the effective angles and track spacings. Computes the number of
  * tracks for each azimuthal angle, allocates memory for all tracks at each
@@ -285,37 +380,25 @@ void TrackGenerator::computeEndPoint(Point* start, Point* end,
 	double yin = start->getY(); 			/* y-coord */
 	double xin = start->getX(); 			/* x-coord */
 
-	try {
-		Point *points = new Point[4];
-
-		/* Determine all possible points */
-		points[0].setCoords(0, yin - m * xin);
-		points[1].setCoords(width, yin + m * (width - xin));
-		points[2].setCoords(xin - yin / m, 0);
-		points[3].setCoords(xin - (yin - height) / m, height);
-
-		/* For each of the possible intersection points */
-		for (int i = 0; i < 4; i++) {
-			/* neglect the trivial point (xin, yin) */
-			if (points[i].getX() == xin && points[i].getY() == yin) { }
-
-			/* The point to return will be within the bounds of the cell */
-			else if (points[i].getX() >= 0 && points[i].getX() <= width
-					&& points[i].getY() >= 0 && points[i].getY() <= height) {
-				end->setCoords(points[i].getX(), points[i].getY());
-			}
-		}
+	Point points[4];
 
-		delete[] points;
-		return;
-	}
+	/* Determine all possible points */
+	points[0].setCoords(0, yin - m * xin);
+	points[1].setCoords(width, yin + m * (width - xin));
+	points[2].setCoords(xin - yin / m, 0);
+	points[3].setCoords(xin - (yin - height) / m, height);
 
-	catch (std::exception &e) {
-		log_printf(ERROR, "Unable to allocate memory for intersection points "
-				"in computeEndPoint method of TrackGenerator. Backtrace:\n%s",
-				e.what());
-	}
+	/* For each of the possible intersection points */
+	for (int i = 0; i < 4; i++) {
+		/* neglect the trivial point (xin, yin) */
+		if (points[i].getX() == xin && points[i].getY() == yin) { }
 
+		/* The point to return will be within the bounds of the cell */
+		else if (points[i].getX() >= 0 && points[i].getX() <= width
+				&& points[i].getY() >= 0 && points[i].getY() <= height) {
+			end->setCoords(points[i].getX(), points[i].getY());
+		}
+	}
 }
 
 
@@ -433,6 +516,528 @@ void TrackGenerator::makeReflective() {
 }
 
 
+/**
+ * Finds the cell of a grid of equal rectangles over the geometry which
+ * contains a point
+ * @param x the x-coordinate of the point
+ * @param y the y-coordinate of the point
+ * @param num_x the number of grid cells along x
+ * @param num_y the number of grid cells along y
+ * @return the index of the grid cell, counting along x first
+ */
+int TrackGenerator::findGridCell(double x, double y, int num_x, int num_y) {
+
+	double width = _geom->getWidth();
+	double height = _geom->getHeight();
+	int ix = (int)((x + width / 2.0) / (width / num_x));
+	int iy = (int)((y + height / 2.0) / (height / num_y));
+
+	ix = std::max(0, std::min(ix, num_x - 1));
+	iy = std::max(0, std::min(iy, num_y - 1));
+
+	return iy * num_x + ix;
+}
+
+
+/**
+ * Finds the distances along a track at which it crosses the boundaries of
+ * a grid of equal rectangles over the geometry. The pieces of the track
+ * between consecutive distances each lie inside a single grid cell
+ * @param track the track to cut
+ * @param num_x the number of grid cells along x
+ * @param num_y the number of grid cells along y
+ * @return the distances from the start point, starting with zero and
+ *         ending with the track length
+ */
+std::vector<double> TrackGenerator::cutTrack(Track* track, int num_x,
+															int num_y) {
+
+	double width = _geom->getWidth();
+	double height = _geom->getHeight();
+	double x0 = track->getStart()->getX();
+	double y0 = track->getStart()->getY();
+	double length = track->getStart()->distance(track->getEnd());
+	double dx = (track->getEnd()->getX() - x0) / length;
+	double dy = (track->getEnd()->getY() - y0) / length;
+	double t;
+	std::vector<double> cuts;
+
+	for (int i = 1; i < num_x; i++) {
+		t = (-width / 2.0 + i * width / num_x - x0) / dx;
+		if (dx != 0.0 && t > ON_SURFACE_THRESH &&
+								t < length - ON_SURFACE_THRESH)
+			cuts.push_back(t);
+	}
+
+	for (int i = 1; i < num_y; i++) {
+		t = (-height / 2.0 + i * height / num_y - y0) / dy;
+		if (dy != 0.0 && t > ON_SURFACE_THRESH &&
+								t < length - ON_SURFACE_THRESH)
+			cuts.push_back(t);
+	}
+
+	std::sort(cuts.begin(), cuts.end());
+
+	/* Merge the cuts at the corners of grid cells */
+	std::vector<double> distances(1, 0.0);
+	for (unsigned int i = 0; i < cuts.size(); i++) {
+		if (cuts[i] - distances.back() > ON_SURFACE_THRESH)
+			distances.push_back(cuts[i]);
+	}
+
+	if (length - distances.back() > ON_SURFACE_THRESH)
+		distances.push_back(length);
+	else
+		distances.back() = length;
+
+	return distances;
+}
+
+
+#if USE_MPI
+/**
+ * Cuts the tracks at the boundaries of a grid of rectangular subdomains,
+ * one per MPI process, and keeps only the pieces inside this process'
+ * subdomain. Each piece is linked to the pieces its fluxes enter, which
+ * are the next piece of the same track or the track it reflects into.
+ * Links to pieces on other processes go through the domain decomposition,
+ * which exchanges their fluxes after each transport sweep. This must be
+ * called after makeReflective and before segmentize
+ * @param num_x the number of subdomains along x
+ * @param num_y the number of subdomains along y
+ */
+void TrackGenerator::decompose(int num_x, int num_y) {
+
+	_domain = new DomainDecomposition(num_x, num_y);
+
+	int rank = _domain->getRank();
+	int num_ranks = _domain->getNumRanks();
+	std::vector<int> azim_offsets(_num_azim, 0);
+	std::vector<int> piece_offsets(1, 0);
+	std::vector<int> piece_azims;
+	std::vector<int> piece_ranks;
+	std::vector<int> piece_indices;
+	std::vector<double> piece_starts;
+	std::vector<double> piece_ends;
+	std::vector<int> num_pieces(num_ranks * _num_azim, 0);
+	std::vector<double> cuts;
+	Track* track;
+	double x0, y0, dx, dy, length, middle;
+	int owner;
+
+	/* Cut every track so that each process knows which process owns the
+	 * neighbouring pieces of its own pieces */
+	for (int i = 0; i < _num_azim; i++) {
+		if (i > 0)
+			azim_offsets[i] = azim_offsets[i-1] + _num_tracks[i-1];
+
+		for (int j = 0; j < _num_tracks[i]; j++) {
+			track = &_tracks[i][j];
+			cuts = cutTrack(track, _domain->getNumX(), _domain->getNumY());
+			x0 = track->getStart()->getX();
+			y0 = track->getStart()->getY();
+			length = cuts.back();
+			dx = (track->getEnd()->getX() - x0) / length;
+			dy = (track->getEnd()->getY() - y0) / length;
+
+			for (unsigned int k = 0; k + 1 < cuts.size(); k++) {
+				middle = 0.5 * (cuts[k] + cuts[k+1]);
+				owner = findGridCell(x0 + middle * dx, y0 + middle * dy,
+								_domain->getNumX(), _domain->getNumY());
+				piece_azims.push_back(i);
+				piece_ranks.push_back(owner);
+				piece_indices.push_back(num_pieces[owner * _num_azim + i]++);
+				piece_starts.push_back(cuts[k]);
+				piece_ends.push_back(cuts[k+1]);
+			}
+
+			piece_offsets.push_back(piece_ranks.size());
+		}
+	}
+
+	/* Make the pieces inside this subdomain */
+	Track** pieces = new Track*[_num_azim];
+	Track* piece;
+
+	for (int i = 0; i < _num_azim; i++)
+		pieces[i] = new Track[num_pieces[rank * _num_azim + i]];
+
+	for (int i = 0; i < _num_azim; i++) {
+		for (int j = 0; j < _num_tracks[i]; j++) {
+			track = &_tracks[i][j];
+			x0 = track->getStart()->getX();
+			y0 = track->getStart()->getY();
+			length = track->getStart()->distance(track->getEnd());
+			dx = (track->getEnd()->getX() - x0) / length;
+			dy = (track->getEnd()->getY() - y0) / length;
+
+			for (int p = piece_offsets[azim_offsets[i] + j];
+					p < piece_offsets[azim_offsets[i] + j + 1]; p++) {
+				if (piece_ranks[p] != rank)
+					continue;
+
+				piece = &pieces[i][piece_indices[p]];
+				piece->setValues(x0 + piece_starts[p] * dx,
+						y0 + piece_starts[p] * dy, x0 + piece_ends[p] * dx,
+						y0 + piece_ends[p] * dy, track->getPhi());
+				piece->setAzimuthalWeight(track->getAzimuthalWeight());
+			}
+		}
+	}
+
+	/* Link each piece's ends to the pieces its fluxes enter */
+	int first, last, next, global_index = 0;
+	bool refl;
+	Track* next_track;
+	Track* target;
+
+	for (int i = 0; i < _num_azim; i++) {
+		for (int j = 0; j < _num_tracks[i]; j++) {
+			track = &_tracks[i][j];
+			first = piece_offsets[azim_offsets[i] + j];
+			last = piece_offsets[azim_offsets[i] + j + 1] - 1;
+
+			for (int p = first; p <= last; p++) {
+				for (int forward = 1; forward >= 0; forward--) {
+
+					/* Find the piece the flux leaving this end enters */
+					if (forward && p < last) {
+						next = p + 1;
+						refl = false;
+					}
+					else if (!forward && p > first) {
+						next = p - 1;
+						refl = true;
+					}
+					else {
+						next_track = forward ? track->getTrackOut() :
+												track->getTrackIn();
+						refl = forward ? track->isReflOut() :
+												track->isReflIn();
+
+						for (int a = 0; a < _num_azim; a++) {
+							if (next_track >= _tracks[a] &&
+									next_track < _tracks[a] + _num_tracks[a])
+								global_index = azim_offsets[a] +
+												(next_track - _tracks[a]);
+						}
+
+						next = refl ? piece_offsets[global_index + 1] - 1 :
+												piece_offsets[global_index];
+					}
+
+					if (piece_ranks[p] != rank && piece_ranks[next] != rank)
+						continue;
+
+					target = NULL;
+					if (piece_ranks[next] == rank)
+						target = &pieces[piece_azims[next]][piece_indices[next]];
+
+					if (piece_ranks[p] != rank) {
+						_domain->addReceiveFlux(piece_ranks[p], target, refl);
+						continue;
+					}
+
+					if (target == NULL)
+						target = _domain->addSendFlux(piece_ranks[next], refl);
+
+					piece = &pieces[i][piece_indices[p]];
+					if (forward) {
+						piece->setTrackOut(target);
+						piece->setReflOut(refl);
+					}
+					else {
+						piece->setTrackIn(target);
+						piece->setReflIn(refl);
+					}
+				}
+			}
+		}
+	}
+
+	/* Replace the tracks with the pieces in this subdomain */
+	for (int i = 0; i < _num_azim; i++) {
+		delete [] _tracks[i];
+		_tracks[i] = pieces[i];
+		_num_tracks[i] = num_pieces[rank * _num_azim + i];
+	}
+
+	delete [] pieces;
+
+	log_printf(NORMAL, "Kept %d of %d track pieces in subdomain %d",
+		(int)std::count(piece_ranks.begin(), piece_ranks.end(), rank),
+		(int)piece_ranks.size(), rank);
+}
+#endif
+
+
+/**
+ * Cuts the tracks at the boundaries of a grid of rectangular tiles and
+ * orders the pieces at each azimuthal angle by tile, so that the transport
+ * sweep can sweep all of the pieces inside one tile before moving on to
+ * the next. If no tile grid is given, the tiles are sized so that the data
+ * of the FSRs inside each one fits in half of the L2 cache. Pieces in the
+ * same tile are linked directly, while the fluxes leaving a tile are held
+ * in ghost tracks and passed to the tile they enter after each sweep, as
+ * at the subdomain boundaries. This must be called after makeReflective
+ * and decompose and before segmentize
+ * @param num_x the number of tiles along x
+ * @param num_y the number of tiles along y
+ */
+void TrackGenerator::tile(int num_x, int num_y) {
+
+	double width = _geom->getWidth();
+	double height = _geom->getHeight();
+
+	if (num_x <= 0 || num_y <= 0) {
+		long cache_size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+		if (cache_size <= 0)
+			cache_size = 256 * 1024;
+
+		/* Each FSR's fluxes, sources and ratios, which are kept together */
+		double FSR_size = sizeof(FlatSourceRegion) +
+								5 * NUM_ENERGY_GROUPS * sizeof(double);
+		int num_tiles = ceil(_geom->getNumFSRs() * FSR_size /
+													(cache_size / 2));
+
+		num_x = std::max(1, (int)round(sqrt(num_tiles * width / height)));
+		num_y = std::max(1, (int)ceil(num_tiles / (double)num_x));
+
+		log_printf(NORMAL, "Sizing tiles for a %ld kB L2 cache...",
+														cache_size / 1024);
+	}
+
+	if (num_x * num_y == 1) {
+		log_printf(NORMAL, "The FSRs fit in one tile, the tracks will not "
+															"be tiled");
+		return;
+	}
+
+	log_printf(NORMAL, "Cutting the tracks into %d x %d tiles...",
+															num_x, num_y);
+
+	_num_tiles = num_x * num_y;
+	_tile_offsets = new int[_num_azim * (_num_tiles + 1)];
+
+	std::vector<int> azim_offsets(_num_azim, 0);
+	std::vector<int> piece_offsets(1, 0);
+	std::vector<int> piece_tiles;
+	std::vector<int> piece_indices;
+	std::vector<double> piece_starts;
+	std::vector<double> piece_ends;
+	std::vector<int> num_pieces(_num_azim * _num_tiles, 0);
+	std::vector<double> cuts;
+	Track* track;
+	double x0, y0, dx, dy, length, middle;
+	int tile_id;
+
+	/* Cut each track and find the tile of each piece */
+	for (int i = 0; i < _num_azim; i++) {
+		if (i > 0)
+			azim_offsets[i] = azim_offsets[i-1] + _num_tracks[i-1];
+
+		for (int j = 0; j < _num_tracks[i]; j++) {
+			track = &_tracks[i][j];
+			cuts = cutTrack(track, num_x, num_y);
+			x0 = track->getStart()->getX();
+			y0 = track->getStart()->getY();
+			length = cuts.back();
+			dx = (track->getEnd()->getX() - x0) / length;
+			dy = (track->getEnd()->getY() - y0) / length;
+
+			for (unsigned int k = 0; k + 1 < cuts.size(); k++) {
+				middle = 0.5 * (cuts[k] + cuts[k+1]);
+				tile_id = findGridCell(x0 + middle * dx, y0 + middle * dy,
+														num_x, num_y);
+				piece_tiles.push_back(tile_id);
+				piece_indices.push_back(num_pieces[i * _num_tiles + tile_id]++);
+				piece_starts.push_back(cuts[k]);
+				piece_ends.push_back(cuts[k+1]);
+			}
+
+			piece_offsets.push_back(piece_tiles.size());
+		}
+	}
+
+	/* Order the pieces at each angle by tile */
+	for (int i = 0; i < _num_azim; i++) {
+		_tile_offsets[i * (_num_tiles + 1)] = 0;
+		for (int t = 0; t < _num_tiles; t++)
+			_tile_offsets[i * (_num_tiles + 1) + t + 1] =
+							_tile_offsets[i * (_num_tiles + 1) + t] +
+							num_pieces[i * _num_tiles + t];
+
+		for (int j = 0; j < _num_tracks[i]; j++) {
+			for (int p = piece_offsets[azim_offsets[i] + j];
+					p < piece_offsets[azim_offsets[i] + j + 1]; p++)
+				piece_indices[p] += _tile_offsets[i * (_num_tiles + 1) +
+															piece_tiles[p]];
+		}
+	}
+
+	/* Make the pieces */
+	Track** pieces = new Track*[_num_azim];
+	Track* piece;
+
+	for (int i = 0; i < _num_azim; i++) {
+		pieces[i] = new Track[_tile_offsets[(i + 1) * (_num_tiles + 1) - 1]];
+
+		for (int j = 0; j < _num_tracks[i]; j++) {
+			track = &_tracks[i][j];
+			x0 = track->getStart()->getX();
+			y0 = track->getStart()->getY();
+			length = track->getStart()->distance(track->getEnd());
+			dx = (track->getEnd()->getX() - x0) / length;
+			dy = (track->getEnd()->getY() - y0) / length;
+
+			for (int p = piece_offsets[azim_offsets[i] + j];
+					p < piece_offsets[azim_offsets[i] + j + 1]; p++) {
+				piece = &pieces[i][piece_indices[p]];
+				piece->setValues(x0 + piece_starts[p] * dx,
+						y0 + piece_starts[p] * dy, x0 + piece_ends[p] * dx,
+						y0 + piece_ends[p] * dy, track->getPhi());
+				piece->setAzimuthalWeight(track->getAzimuthalWeight());
+			}
+		}
+	}
+
+	/* Link each piece's ends to the pieces its fluxes enter */
+	int first, last, next, next_azim;
+	bool refl;
+	Track* next_track;
+	Track* target;
+	tile_flux flux;
+	double zeros[GRP_TIMES_ANG] = {0.0};
+
+	for (int i = 0; i < _num_azim; i++) {
+		for (int j = 0; j < _num_tracks[i]; j++) {
+			track = &_tracks[i][j];
+			first = piece_offsets[azim_offsets[i] + j];
+			last = piece_offsets[azim_offsets[i] + j + 1] - 1;
+
+			for (int p = first; p <= last; p++) {
+				for (int forward = 1; forward >= 0; forward--) {
+
+					/* Find the piece the flux leaving this end enters */
+					next = -1;
+					next_azim = i;
+					next_track = NULL;
+
+					if (forward && p < last) {
+						next = p + 1;
+						refl = false;
+					}
+					else if (!forward && p > first) {
+						next = p - 1;
+						refl = true;
+					}
+					else {
+						next_track = forward ? track->getTrackOut() :
+												track->getTrackIn();
+						refl = forward ? track->isReflOut() :
+												track->isReflIn();
+
+						/* Tracks leaving this process' subdomain keep
+						 * their ghost track */
+						for (int a = 0; a < _num_azim; a++) {
+							if (next_track >= _tracks[a] &&
+									next_track < _tracks[a] + _num_tracks[a]) {
+								next = azim_offsets[a] +
+												(next_track - _tracks[a]);
+								next = refl ? piece_offsets[next + 1] - 1 :
+												piece_offsets[next];
+								next_azim = a;
+							}
+						}
+					}
+
+					if (next < 0)
+						target = next_track;
+					else if (piece_tiles[next] == piece_tiles[p])
+						target = &pieces[next_azim][piece_indices[next]];
+					else {
+						flux._ghost = new Track();
+						flux._ghost->setValues(0.0, 0.0, 0.0, 0.0, 0.0);
+						flux._ghost->setPolarFluxes(false, 0, zeros);
+						flux._ghost->setPolarFluxes(true, 0, zeros);
+						flux._track = &pieces[next_azim][piece_indices[next]];
+						flux._direction = refl;
+						_tile_fluxes.push_back(flux);
+						target = flux._ghost;
+					}
+
+					piece = &pieces[i][piece_indices[p]];
+					if (forward) {
+						piece->setTrackOut(target);
+						piece->setReflOut(refl);
+					}
+					else {
+						piece->setTrackIn(target);
+						piece->setReflIn(refl);
+					}
+				}
+			}
+		}
+	}
+
+#if USE_MPI
+	/* Pass the fluxes received from other processes to the pieces */
+	if (_domain != NULL) {
+		std::map<Track*, std::pair<Track*, Track*> > ends;
+
+		for (int i = 0; i < _num_azim; i++) {
+			for (int j = 0; j < _num_tracks[i]; j++) {
+				first = piece_offsets[azim_offsets[i] + j];
+				last = piece_offsets[azim_offsets[i] + j + 1] - 1;
+				ends[&_tracks[i][j]] = std::make_pair(
+								&pieces[i][piece_indices[first]],
+								&pieces[i][piece_indices[last]]);
+			}
+		}
+
+		_domain->replaceTracks(ends);
+	}
+#endif
+
+	/* Replace the tracks with the pieces */
+	for (int i = 0; i < _num_azim; i++) {
+		delete [] _tracks[i];
+		_tracks[i] = pieces[i];
+		_num_tracks[i] = _tile_offsets[(i + 1) * (_num_tiles + 1) - 1];
+	}
+
+	delete [] pieces;
+
+	log_printf(NORMAL, "Cut the tracks into %d pieces with %d fluxes "
+					"passed between tiles", (int)piece_tiles.size(),
+					(int)_tile_fluxes.size());
+}
+
+
+/**
+ * Passes the angular fluxes which left each tile in the last transport
+ * sweep to the track pieces they enter in the neighbouring tiles
+ * @param groups the energy groups which were swept
+ * @param num_groups the number of energy groups in the list
+ */
+void TrackGenerator::passTileFluxes(int* groups, int num_groups) {
+
+	int num_fluxes = _tile_fluxes.size();
+	tile_flux* flux;
+
+	#if USE_OPENMP
+	#pragma omp parallel for private(flux)
+	#endif
+	for (int i = 0; i < num_fluxes; i++) {
+		flux = &_tile_fluxes[i];
+		flux->_track->setPolarFluxes(flux->_direction,
+							flux->_direction * GRP_TIMES_ANG,
+							flux->_ghost->getPolarFluxes(), groups,
+							num_groups);
+	}
+}
+
+
 /**
  * Generate segments for each track and plot segments
  * in bitmap array.
@@ -508,3 +1113,290 @@ void TrackGenerator::segmentize() {
 }
 
 
+/**
+ * Renumbers the FSRs in the order the transport sweep first reaches them,
+ * so that the FSRs along each track and inside each tile are stored close
+ * together. The segments' FSR ids are replaced with the new ids and the
+ * geometry keeps the original ids for the output. FSRs which no track
+ * crosses are numbered last. This must be called after segmentize
+ */
+void TrackGenerator::renumberFSRs() {
+
+#if USE_MPI
+	/* The FSR tallies are added up over all processes by FSR id */
+	if (_domain != NULL) {
+		log_printf(WARNING, "Unable to renumber the FSRs of a decomposed "
+							"geometry, they will keep their original ids");
+		return;
+	}
+#endif
+
+	if (_segment_database != NULL) {
+		log_printf(WARNING, "Unable to renumber the FSRs since the segments "
+							"are shared read-only in %s, they will keep "
+							"their original ids",
+							_segment_database->getPath().c_str());
+		return;
+	}
+
+	log_printf(NORMAL, "Renumbering FSRs in sweep order...");
+
+	int num_FSRs = _geom->getNumFSRs();
+	std::vector<int> internal_ids(num_FSRs, -1);
+	std::vector<int> external_ids;
+	Track* track;
+	segment* seg;
+	int first, last;
+
+	/* Number the FSRs in the order of the tiles, angles and tracks which
+	 * the sweep follows */
+	for (int t = 0; t < _num_tiles; t++) {
+		for (int i = 0; i < _num_azim; i++) {
+			first = 0;
+			last = _num_tracks[i];
+
+			if (_tile_offsets != NULL) {
+				first = _tile_offsets[i * (_num_tiles + 1) + t];
+				last = _tile_offsets[i * (_num_tiles + 1) + t + 1];
+			}
+
+			for (int j = first; j < last; j++) {
+				track = &_tracks[i][j];
+
+				for (int s = 0; s < track->getNumSegments(); s++) {
+					seg = track->getSegment(s);
+
+					if (internal_ids[seg->_region_id] < 0) {
+						internal_ids[seg->_region_id] = external_ids.size();
+						external_ids.push_back(seg->_region_id);
+					}
+
+					seg->_region_id = internal_ids[seg->_region_id];
+				}
+			}
+		}
+	}
+
+	for (int r = 0; r < num_FSRs; r++) {
+		if (internal_ids[r] < 0) {
+			internal_ids[r] = external_ids.size();
+			external_ids.push_back(r);
+		}
+	}
+
+	_geom->renumberFSRs(external_ids);
+}
+
+
+/**
+ * Splits the directions of all tracks into chains in which each direction
+ * passes its outgoing angular fluxes to the next one, so that a sweep
+ * along a chain uses each flux in the same iteration it is computed. With
+ * reflective boundaries the chains are closed cycles. Chains which start
+ * with fluxes from another subdomain or tile and end in a ghost track are
+ * open. The chains are ordered by their number of segments, longest first,
+ * so that threads which take them in turn finish together. This must be
+ * called after segmentize
+ */
+void TrackGenerator::makeChains() {
+
+	std::vector<int> azim_offsets(_num_azim, 0);
+	int num_tracks = 0;
+
+	for (int i = 0; i < _num_azim; i++) {
+		azim_offsets[i] = num_tracks;
+		num_tracks += _num_tracks[i];
+	}
+
+	/* Find the direction which each track direction passes its fluxes to.
+	 * Direction 2 * t is track t forward and 2 * t + 1 is track t reversed,
+	 * which reads the fluxes in the half of the polar fluxes set by refl */
+	std::vector<int> next(2 * num_tracks, -1);
+	std::vector<bool> entered(2 * num_tracks, false);
+	std::vector<chain_link> links(2 * num_tracks);
+	Track* track;
+	Track* target;
+	bool refl;
+	int d;
+
+	for (int i = 0; i < _num_azim; i++) {
+		for (int j = 0; j < _num_tracks[i]; j++) {
+			track = &_tracks[i][j];
+
+			for (int reverse = 0; reverse < 2; reverse++) {
+				d = 2 * (azim_offsets[i] + j) + reverse;
+				links[d]._track = track;
+				links[d]._reverse = reverse;
+				target = reverse ? track->getTrackIn() : track->getTrackOut();
+				refl = reverse ? track->isReflIn() : track->isReflOut();
+
+				/* Ghost tracks end the chain */
+				for (int a = 0; a < _num_azim; a++) {
+					if (target >= _tracks[a] &&
+								target < _tracks[a] + _num_tracks[a]) {
+						next[d] = 2 * (azim_offsets[a] +
+											(target - _tracks[a])) + refl;
+						entered[next[d]] = true;
+					}
+				}
+			}
+		}
+	}
+
+	/* Follow the open chains from their first direction and then the
+	 * cycles from any direction which is left */
+	std::vector<bool> visited(2 * num_tracks, false);
+	std::vector<std::vector<int> > chains;
+	std::vector<std::pair<int, int> > lengths;
+
+	for (int open = 1; open >= 0; open--) {
+		for (int first = 0; first < 2 * num_tracks; first++) {
+			if (visited[first] || (open && entered[first]))
+				continue;
+
+			chains.push_back(std::vector<int>());
+			lengths.push_back(std::make_pair(0, (int)lengths.size()));
+
+			for (d = first; d >= 0 && !visited[d]; d = next[d]) {
+				visited[d] = true;
+				chains.back().push_back(d);
+				lengths.back().first += links[d]._track->getNumSegments();
+			}
+		}
+	}
+
+	std::stable_sort(lengths.begin(), lengths.end(),
+						std::greater<std::pair<int, int> >());
+
+	_chain_links.clear();
+	_chain_offsets.assign(1, 0);
+
+	for (unsigned int c = 0; c < lengths.size(); c++) {
+		std::vector<int>& chain = chains[lengths[c].second];
+
+		for (unsigned int l = 0; l < chain.size(); l++)
+			_chain_links.push_back(links[chain[l]]);
+
+		_chain_offsets.push_back(_chain_links.size());
+	}
+
+	log_printf(NORMAL, "Linked the track directions into %d chains with "
+				"%d to %d segments", getNumChains(), lengths.back().first,
+				lengths.front().first);
+}
+
+
+/**
+ * Reallocates the segments of each track in the thread which sweeps it, so
+ * that with the threads pinned to their sockets the segments are stored on
+ * the socket which reads them. The tracks are assigned to the threads as
+ * in the default transport sweep, one pair of reflecting azimuthal angles
+ * per thread, and each thread copies its segments into an arena of its
+ * own. The arenas the segments were in before are then released. This must
+ * be called after segmentize and before the solver is created, since it
+ * keeps pointers to the segments
+ */
+void TrackGenerator::localizeSegments() {
+
+	/* The shared segments are mapped from a file */
+	if (_segment_database != NULL)
+		return;
+
+	int num_threads = _num_azim / 2;
+	int azim;
+	std::vector<Arena*> old_arenas = _segment_arenas;
+	char name[32];
+
+	_segment_arenas.clear();
+	for (int t = 0; t < num_threads; t++) {
+		snprintf(name, sizeof(name), "segments of thread %d", t);
+		_segment_arenas.push_back(new Arena(name));
+		_segment_arenas.back()->setHugePages(_huge_pages);
+	}
+
+	#if USE_OPENMP
+	#pragma omp parallel for num_threads(num_threads) private(azim)
+	#endif
+	for (int t = 0; t < num_threads; t++) {
+		for (int a = 0; a < 2; a++) {
+			azim = a ? _num_azim - t - 1 : t;
+			for (int j = 0; j < _num_tracks[azim]; j++)
+				_tracks[azim][j].reallocateSegments(_segment_arenas[t]);
+		}
+	}
+
+	for (unsigned int i = 0; i < old_arenas.size(); i++)
+		delete old_arenas[i];
+	_geom->getSegmentArena()->release();
+
+	log_printf(INFO, "Reallocated the segments in the threads which sweep "
+													"them");
+}
+
+
+/**
+ * Sets whether the arenas the segments are reallocated in are backed by
+ * huge pages
+ * @param huge_pages whether or not to use huge pages
+ */
+void TrackGenerator::setHugePages(bool huge_pages) {
+	_huge_pages = huge_pages;
+}
+
+
+/**
+ * Prints the memory used by the arenas which hold the segments
+ */
+void TrackGenerator::printArenaUsage() {
+	_geom->getSegmentArena()->printUsage();
+
+	for (unsigned int i = 0; i < _segment_arenas.size(); i++)
+		_segment_arenas[i]->printUsage();
+}
+
+
+/**
+ * Maps the segments of all tracks from a shared segment database file
+ * instead of keeping them in each track. If the file does not exist or
+ * does not match these tracks, the tracks are segmented and the database
+ * is written first. The tracks' own segments are then freed so that
+ * processes sharing the file only keep their own fluxes and sources
+ * @param path the path of the segment database file
+ */
+void TrackGenerator::shareSegments(const char* path) {
+
+#if CMFD_ACCEL
+	/* The segments hold the process' own CMFD mesh surfaces */
+	log_printf(WARNING, "Unable to share the segments in %s with CMFD "
+							"acceleration, each track will keep its own "
+							"segments", path);
+	segmentize();
+	return;
+#endif
+
+	_segment_database = new SegmentDatabase();
+
+	if (_segment_database->map(path, _num_tracks, _num_azim, _spacing,
+											_geom->getNumFSRs()))
+		return;
+
+	segmentize();
+
+	if (!SegmentDatabase::write(path, _tracks, _num_tracks, _num_azim,
+										_spacing, _geom->getNumFSRs()) ||
+				!_segment_database->map(path, _num_tracks, _num_azim,
+										_spacing, _geom->getNumFSRs())) {
+		log_printf(WARNING, "Unable to share the segments in %s, each track "
+									"will keep its own segments", path);
+		delete _segment_database;
+		_segment_database = NULL;
+		return;
+	}
+
+	for (int i = 0; i < _num_azim; i++) {
+		for (int j = 0; j < _num_tracks[i]; j++)
+			_tracks[i][j].clearSegments();
+	}
+
+	_geom->getSegmentArena()->release();
+}
@@ -12,11 +12,34 @@
 
 #define _USE_MATH_DEFINES
 #include <math.h>
+#include <unistd.h>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <functional>
 #include "Point.h"
 #include "Track.h"
 #include "Geometry.h"
 #include "Plotter.h"
+#include "SegmentDatabase.h"
+#include "DomainDecomposition.h"
 
+/* Angular fluxes passed from a track piece in one tile to a piece in
+ * another. The transport sweep writes them to the ghost track, and they
+ * are copied to the direction half of the target's polar fluxes after it */
+struct tile_flux {
+	Track* _ghost;
+	Track* _track;
+	bool _direction;
+};
+
+
+/* One direction of a track in a chain of tracks, each of which passes
+ * its outgoing angular fluxes to the next */
+struct chain_link {
+	Track* _track;
+	bool _reverse;
+};
 
 class TrackGenerator {
 private:
@@ -29,6 +52,26 @@ private:
 	Track** _tracks;
 	Geometry* _geom;
 	Plotter* _plotter;
+	/* Shared read-only segments used instead of the tracks' own ones */
+	SegmentDatabase* _segment_database;
+#if USE_MPI
+	/* Subdomain of this process, or NULL if it holds all tracks */
+	DomainDecomposition* _domain;
+#endif
+	/* Tiles which the track pieces are swept in, with the index of the
+	 * first piece of each tile for each azimuthal angle */
+	int _num_tiles;
+	int* _tile_offsets;
+	std::vector<tile_flux> _tile_fluxes;
+	/* Chains of track directions linked by their angular fluxes, longest
+	 * first, with the index of the first link of each chain */
+	std::vector<chain_link> _chain_links;
+	std::vector<int> _chain_offsets;
+	/* Segments reallocated by each thread which sweeps them */
+	std::vector<Arena*> _segment_arenas;
+	bool _huge_pages;
+	std::vector<double> cutTrack(Track* track, int num_x, int num_y);
+	int findGridCell(double x, double y, int num_x, int num_y);
 public:
 	TrackGenerator(Geometry* geom, Plotter* plotter,
 			const int num_azim,const double spacing);
@@ -38,11 +81,31 @@ public:
     int *getNumTracks() const;
     double getSpacing() const;
     Track **getTracks() const;
+    SegmentDatabase* getSegmentDatabase() const;
+    int getNumTiles() const;
+    int* getTileOffsets() const;
+    int getNumChains() const;
+    const chain_link* getChainLinks() const;
+    const int* getChainOffsets() const;
+#if USE_MPI
+    DomainDecomposition* getDomainDecomposition() const;
+#endif
     void generateTracks();
 	void computeEndPoint(Point* start, Point* end,  const double phi,
 			const double width, const double height);
 	void makeReflective();
+#if USE_MPI
+	void decompose(int num_x, int num_y);
+#endif
+	void tile(int num_x, int num_y);
+	void passTileFluxes(int* groups, int num_groups);
 	void segmentize();
+	void renumberFSRs();
+	void makeChains();
+	void localizeSegments();
+	void setHugePages(bool huge_pages);
+	void printArenaUsage();
+	void shareSegments(const char* path);
 	void printTrackingTimers();
 };
 
@@ -42,6 +42,20 @@
 /* If this machine has OpenMP installed, define as true for parallel speedup */
 #define USE_OPENMP true
 
+/* Decompose the geometry into rectangular subdomains, one per MPI process,
+ * if true. The code must then be compiled with an MPI compiler wrapper */
+#define USE_MPI false
+
+/* Store the FSR fluxes, sources and source / sigma_t ratios FSR-major
+ * (the energy groups of each FSR are contiguous) if true, or group-major
+ * (the FSRs of each energy group are contiguous) if false */
+#define FSR_MAJOR true
+
+/* Normalize the fluxes and compute the sources and source / sigma_t ratios
+ * in a single parallel pass over the FSRs in each source iteration. Set to
+ * false to use the original serial loops, e.g. to verify results */
+#define FUSED_SOURCE_UPDATE true
+
 /* Perform CMFD acceleration in the solver on a lattice level */
 #define CMFD_ACCEL false
 #define CMFD_LEVEL 1
@@ -16,15 +16,298 @@
 #include "Options.h"
 #include "Solver.h"
 #include "Timer.h"
+#include "PerfCounters.h"
+#include "ThreadAffinity.h"
 #include "log.h"
 #include "configurations.h"
 #include "Plotter.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 // FIXME: These should be removed when main() is properly implemented
 #pragma GCC diagnostic ignored "-Wunused"
 #pragma GCC diagnostic ignored "-Wunused-variable"
 
+
+/**
+ * Replaces the cross-sections of the geometry's materials with those of
+ * the materials in a material file. Materials which are not in the
+ * geometry are skipped
+ * @param parser pointer to the parser
+ * @param geometry pointer to the geometry
+ * @param material_file the path of the material file
+ * @return the geometry's materials whose cross-sections changed
+ */
+static std::vector<Material*> updateMaterials(Parser* parser,
+						Geometry* geometry, const char* material_file) {
+
+	std::vector<Material*> changed;
+
+	parser->parseMaterials(material_file);
+	parser->each_material([&](Material* material) -> void
+			{
+				if (!geometry->hasMaterial(material->getId())) {
+					log_printf(WARNING, "Skipping material id = %d in %s "
+							"which is not in the geometry",
+							material->getId(), material_file);
+					return;
+				}
+
+				Material* old = geometry->updateMaterial(material);
+				if (old != NULL)
+					changed.push_back(old);
+			});
+
+	return changed;
+}
+
+
+/**
+ * Solves one server job and writes a single line reply. A job is the path
+ * of a material file followed by optional keff_tolerance, source_tolerance,
+ * flux_tolerance, max_iterations and output settings given as key=value.
+ * Settings which are not given take the values from the command line. The
+ * reply is "ok k_eff=<k_eff> iterations=<n> time=<sec>", followed by
+ * "output=<path>" if the fluxes were written, or "error <reason>"
+ * @param job the job line, which is modified
+ * @param reply the stream for the reply
+ * @param parser pointer to the parser
+ * @param geometry pointer to the geometry
+ * @param solver pointer to the solver
+ * @param opts pointer to the command line options
+ */
+static void solveJob(char* job, FILE* reply, Parser* parser,
+							Geometry* geometry, Solver* solver, Options* opts) {
+
+	double keff_tolerance = opts->getKeffTolerance();
+	double source_tolerance = opts->getSourceTolerance();
+	double flux_tolerance = opts->getFluxTolerance();
+	int max_iterations = MAX_ITERATIONS;
+	const char* output = NULL;
+	char* material_file = strtok(job, " \t");
+	char* value;
+	double k_eff;
+	Timer timer;
+	FILE* file;
+
+	/* Check the job before changing any of the solver's state */
+	file = fopen(material_file, "r");
+	if (file == NULL) {
+		fprintf(reply, "error unable to open material file %s\n",
+														material_file);
+		fflush(reply);
+		return;
+	}
+	fclose(file);
+
+	for (char* token = strtok(NULL, " \t"); token != NULL;
+								token = strtok(NULL, " \t")) {
+		value = strchr(token, '=');
+
+		if (value != NULL) {
+			*value = '\0';
+			value++;
+		}
+
+		if (value == NULL || *value == '\0') {
+			fprintf(reply, "error setting %s has no value\n", token);
+			fflush(reply);
+			return;
+		}
+		else if (strcmp(token, "keff_tolerance") == 0)
+			keff_tolerance = atof(value);
+		else if (strcmp(token, "source_tolerance") == 0)
+			source_tolerance = atof(value);
+		else if (strcmp(token, "flux_tolerance") == 0)
+			flux_tolerance = atof(value);
+		else if (strcmp(token, "max_iterations") == 0)
+			max_iterations = atoi(value);
+		else if (strcmp(token, "output") == 0)
+			output = value;
+		else {
+			fprintf(reply, "error unknown setting %s\n", token);
+			fflush(reply);
+			return;
+		}
+	}
+
+	if (keff_tolerance <= 0.0 || source_tolerance < 0.0 ||
+							flux_tolerance < 0.0 || max_iterations < 1) {
+		fprintf(reply, "error the k_eff tolerance and maximum iterations "
+				"must be positive and the other tolerances not negative\n");
+		fflush(reply);
+		return;
+	}
+
+	log_printf(NORMAL, "Server job: %s", material_file);
+
+	solver->setKeffTolerance(keff_tolerance);
+	solver->setSourceTolerance(source_tolerance,
+							opts->sourceNormLinf() ? LINF_NORM : L2_NORM);
+	solver->setFluxTolerance(flux_tolerance);
+
+	timer.start();
+	solver->updateMaterials(updateMaterials(parser, geometry,
+												material_file));
+	k_eff = solver->computeKeff(max_iterations);
+	timer.stop();
+
+	/* Only the first job starts from the restart file */
+	solver->setRestartFile("");
+
+	fprintf(reply, "ok k_eff=%.8f iterations=%d time=%f", k_eff,
+							solver->getNumIterations(), timer.getTime());
+
+	if (output != NULL && solver->writeScalarFluxes(output))
+		fprintf(reply, " output=%s", output);
+
+	fprintf(reply, "\n");
+	fflush(reply);
+
+	return;
+}
+
+
+/**
+ * Fills a lattice cell with a different universe for the following jobs.
+ * A swap job is "swap <lattice id> <x> <y> <universe id>" and the reply is
+ * "ok" or "error <reason>"
+ * @param job the job line
+ * @param reply the stream for the reply
+ * @param solver pointer to the solver
+ */
+static void swapJob(char* job, FILE* reply, Solver* solver) {
+
+	int lattice_id, lattice_x, lattice_y, universe_id;
+
+	if (sscanf(job, "swap %d %d %d %d", &lattice_id, &lattice_x,
+									&lattice_y, &universe_id) != 4)
+		fprintf(reply, "error a swap needs a lattice id, lattice cell x and "
+				"y indices and a universe id\n");
+	else if (!solver->swapLatticeUniverse(lattice_id, lattice_x, lattice_y,
+														universe_id))
+		fprintf(reply, "error unable to swap universe %d into lattice %d\n",
+												universe_id, lattice_id);
+	else
+		fprintf(reply, "ok\n");
+
+	fflush(reply);
+
+	return;
+}
+
+
+/**
+ * Solves the jobs read from a stream, one per line, until the end of the
+ * stream or a quit line. Lines starting with swap are lattice swap jobs.
+ * Empty lines and lines starting with # are skipped
+ * @param jobs the stream of jobs
+ * @param reply the stream for the replies
+ * @param parser pointer to the parser
+ * @param geometry pointer to the geometry
+ * @param solver pointer to the solver
+ * @param opts pointer to the command line options
+ * @return whether or not the server should quit
+ */
+static bool serveJobs(FILE* jobs, FILE* reply, Parser* parser,
+							Geometry* geometry, Solver* solver, Options* opts) {
+
+	char line[4096];
+	size_t length;
+
+	while (fgets(line, sizeof(line), jobs) != NULL) {
+		length = strlen(line);
+		while (length > 0 && isspace(line[length - 1]))
+			line[--length] = '\0';
+
+		if (length == 0 || line[0] == '#')
+			continue;
+
+		if (strcmp(line, "quit") == 0)
+			return true;
+
+		if (strncmp(line, "swap ", 5) == 0)
+			swapJob(line, reply, solver);
+		else
+			solveJob(line, reply, parser, geometry, solver, opts);
+	}
+
+	return false;
+}
+
+
+/**
+ * Keeps the geometry, tracks, segments and pre-factors and solves jobs
+ * back to back, each warm started from the solution of the previous job.
+ * Jobs are read from stdin with replies on stdout, or from each connection
+ * to a Unix domain socket in turn until a connection sends quit
+ * @param parser pointer to the parser
+ * @param geometry pointer to the geometry
+ * @param solver pointer to the solver
+ * @param opts pointer to the command line options
+ */
+static void runServer(Parser* parser, Geometry* geometry, Solver* solver,
+															Options* opts) {
+
+	std::string path = opts->getServerSocket();
+	struct sockaddr_un address;
+	int server_fd, fd;
+	bool quit = false;
+	FILE* jobs;
+	FILE* reply;
+
+	solver->setWarmStart(true);
+
+	if (path.empty()) {
+		log_printf(NORMAL, "Server reading jobs from stdin...");
+		serveJobs(stdin, stdout, parser, geometry, solver, opts);
+		return;
+	}
+
+	if (path.size() >= sizeof(address.sun_path))
+		log_printf(ERROR, "Server socket path %s is too long", path.c_str());
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+	server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(path.c_str());
+
+	if (server_fd < 0 || bind(server_fd, (struct sockaddr*)&address,
+					sizeof(address)) != 0 || listen(server_fd, 16) != 0)
+		log_printf(ERROR, "Unable to listen on server socket %s",
+														path.c_str());
+
+	log_printf(NORMAL, "Server listening on %s...", path.c_str());
+
+	/* Connections wait in the listen queue while a job is solved */
+	while (!quit) {
+		fd = accept(server_fd, NULL, NULL);
+
+		if (fd < 0) {
+			log_printf(WARNING, "Unable to accept a server connection");
+			continue;
+		}
+
+		jobs = fdopen(fd, "r");
+		reply = fdopen(dup(fd), "w");
+		quit = serveJobs(jobs, reply, parser, geometry, solver, opts);
+		fclose(jobs);
+		fclose(reply);
+	}
+
+	close(server_fd);
+	unlink(path.c_str());
+
+	return;
+}
+
 int main(int argc, const char **argv) {
+#if USE_MPI
+	MPI_Init(&argc, (char***)&argv);
+#endif
 	log_printf(NORMAL, "Starting OpenMOC...");
 
 	double k_eff;
@@ -36,6 +319,54 @@ int main(int argc, const char **argv) {
 	/* Set the verbosity */
 	log_setlevel(opts.getVerbosity());
 
+	/* Count the cache misses of the solve if requested at runtime. The
+	 * counters must be opened before any OpenMP threads are started */
+	PerfCounters* counters = NULL;
+	if (opts.hardwareCounters())
+		counters = new PerfCounters();
+
+	/* Pin the threads to their CPUs if requested at runtime, before the
+	 * tracks and FSR data are allocated. Under MPI the processes are
+	 * bound to their sockets by the launcher */
+#if USE_MPI
+	if (opts.pinThreads())
+		log_printf(WARNING, "Unable to pin the threads of each process with "
+							"MPI, bind the processes with the launcher");
+#else
+	if (opts.pinThreads()) {
+		ThreadAffinity affinity;
+		affinity.pin(opts.getNumAzim() / 2, opts.getNumSockets(),
+												opts.scatterThreads());
+	}
+#endif
+
+	/* Only the first process writes the output files */
+	bool root = true;
+	std::string checkpoint_file = opts.getCheckpointFile();
+	std::string restart_file = opts.getRestartFile();
+
+#if USE_MPI
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	root = (rank == 0);
+
+	/* The other processes only report errors */
+	if (!root)
+		log_setlevel(ERROR);
+
+	if (opts.server() || opts.arnoldi() || opts.batchSweep() ||
+								!opts.getSegmentDatabase().empty())
+		log_printf(ERROR, "The server, Arnoldi, batched sweep and segment "
+				"database options need all tracks in one process and are "
+				"not supported with MPI domain decomposition");
+
+	/* Each process checkpoints the angular fluxes of its own tracks */
+	if (!checkpoint_file.empty())
+		checkpoint_file += "." + std::to_string(rank);
+	if (!restart_file.empty())
+		restart_file += "." + std::to_string(rank);
+#endif
+
 	/* Initialize the parser and time the parser */
 	timer.start();
 	Parser parser(&opts);
@@ -64,6 +395,12 @@ int main(int argc, const char **argv) {
 	TrackGenerator track_generator(&geometry, &plotter, opts.getNumAzim(),
 				       opts.getTrackSpacing());
 
+	/* Back the segment arenas with huge pages if requested at runtime */
+	if (opts.hugePages()) {
+		geometry.getSegmentArena()->setHugePages(true);
+		track_generator.setHugePages(true);
+	}
+
 	/* create CMFD Mesh */
 #if CMFD_ACCEL
 		geometry.makeCMFDMesh();
@@ -77,26 +414,84 @@ int main(int argc, const char **argv) {
 	timer.start();
 	track_generator.generateTracks();
 	track_generator.makeReflective();
+#if USE_MPI
+	track_generator.decompose(opts.getNumDomainsX(), opts.getNumDomainsY());
+#endif
+	if (opts.tiles())
+		track_generator.tile(opts.getNumTilesX(), opts.getNumTilesY());
 	timer.stop();
 	timer.recordSplit("Generating tracks");
 
 	/* Segment tracks */
 	timer.reset();
 	timer.start();
-	track_generator.segmentize();
+	if (opts.getSegmentDatabase().empty())
+		track_generator.segmentize();
+	else
+		track_generator.shareSegments(opts.getSegmentDatabase().c_str());
+	if (opts.renumberFSRs())
+		track_generator.renumberFSRs();
+
+	/* The chains are swept along the tracks' own segments, and tiles are
+	 * swept in their own order */
+	if (opts.chains() && track_generator.getSegmentDatabase() != NULL)
+		log_printf(WARNING, "Unable to sweep the tracks in chains since the "
+								"segments are shared read-only");
+	else if (opts.chains() && track_generator.getNumTiles() > 1)
+		log_printf(WARNING, "Unable to sweep the tracks in chains since they "
+								"are swept by tile");
+	else if (opts.chains())
+		track_generator.makeChains();
+
+	/* Store each thread's segments on its own socket */
+	if (opts.pinThreads())
+		track_generator.localizeSegments();
 	timer.stop();
 	timer.recordSplit("Segmenting tracks");
+	track_generator.printArenaUsage();
 
 	/* Fixed source iteration to solve for k_eff */
 	Solver solver(&geometry, &track_generator, &plotter);
+	solver.setEnergyGaussSeidel(opts.energyGaussSeidel());
+	solver.setNumUpscatterIterations(opts.getNumUpscatterIterations());
+	solver.setCoarseGroupBounds(opts.getCoarseGroupBounds());
+	solver.setCoarseMeshRebalance(opts.coarseMeshRebalance());
+	solver.setSkipConvergedGroups(opts.skipConvergedGroups());
+	solver.setKeffTolerance(opts.getKeffTolerance());
+	solver.setSourceTolerance(opts.getSourceTolerance(),
+							opts.sourceNormLinf() ? LINF_NORM : L2_NORM);
+	solver.setFluxTolerance(opts.getFluxTolerance());
+	solver.setCheckpointFile(checkpoint_file, opts.getCheckpointInterval());
+	solver.setRestartFile(restart_file);
+
+	/* Solve jobs for new material files until told to quit */
+	if (opts.server()) {
+		runServer(&parser, &geometry, &solver, &opts);
+		log_printf(NORMAL, "Program complete");
+		timer.printSplits();
+		return 0;
+	}
+
 	timer.reset();
 	timer.start();
-	k_eff = solver.computeKeff(MAX_ITERATIONS);
+	if (counters != NULL)
+		counters->start();
+	if (opts.arnoldi()) {
+		solver.setComputeSecondEigenvalue(opts.secondEigenvalue());
+		k_eff = solver.computeKeffArnoldi(MAX_ITERATIONS);
+	}
+	else
+		k_eff = solver.computeKeff(MAX_ITERATIONS);
 	timer.stop();
 	timer.recordSplit("Fixed source iteration");
+	if (counters != NULL) {
+		counters->stop();
+		counters->recordSplit("Fixed source iteration");
+	}
+	double solve_time = timer.getTime();
 
 	/* Compute pin powers if requested at run time */
-	if (opts.computePinPowers())
+	if (opts.computePinPowers() && root)
 		solver.computePinPowers();
 
 	if (opts.cmfd())
@@ -104,7 +499,112 @@ int main(int argc, const char **argv) {
 
 	log_printf(RESULT, "k_eff = %f", k_eff);
 
+	if (opts.secondEigenvalue()) {
+		log_printf(RESULT, "k_2 = %f", solver.getSecondEigenvalue());
+		log_printf(RESULT, "dominance ratio = %f", solver.getDominanceRatio());
+	}
+
+	/* Solve each material file in batch mode with the same geometry, tracks
+	 * and segments. The cross-sections are replaced in place, only the
+	 * pre-factors of the changed materials are recomputed and each case
+	 * starts from the previous solution */
+	std::vector<std::string> batch_files = opts.getBatchMaterialFiles();
+
+	if (batch_files.size() > 0) {
+		FILE* summary = fopen(root ? opts.getBatchSummaryFile().c_str() :
+														"/dev/null", "w");
+		if (summary == NULL)
+			log_printf(ERROR, "Unable to open batch summary file %s",
+									opts.getBatchSummaryFile().c_str());
+
+		fprintf(summary, "# material file, k_eff, iterations, time (sec)\n");
+		fprintf(summary, "%s %.8f %d %f\n", opts.getMaterialFile(), k_eff,
+								solver.getNumIterations(), solve_time);
+
+		solver.setWarmStart(true);
+		solver.setRestartFile("");
+
+		/* The batched sweep needs the tracks' own segments */
+		bool batch_sweep = opts.batchSweep();
+		if (batch_sweep && track_generator.getSegmentDatabase() != NULL) {
+			log_printf(WARNING, "Solving the batch cases in turn since the "
+									"segments are shared read-only");
+			batch_sweep = false;
+		}
+		else if (batch_sweep && track_generator.getNumTiles() > 1) {
+			log_printf(WARNING, "Solving the batch cases in turn since the "
+									"tracks are tiled");
+			batch_sweep = false;
+		}
+
+		/* Solve all of the cases together, sweeping the segments once per
+		 * source iteration for all cases which have not converged */
+		if (batch_sweep) {
+			std::vector<std::map<int, Material*> > case_materials;
+
+			for (unsigned int i = 0; i < batch_files.size(); i++) {
+				std::map<int, Material*> materials;
+
+				parser.parseMaterials(batch_files[i].c_str());
+				parser.each_material([&](Material* material) -> void
+						{
+							materials[material->getId()] = material;
+						});
+
+				case_materials.push_back(materials);
+			}
+
+			timer.reset();
+			timer.start();
+			std::vector<double> k_effs = solver.computeKeffBatch(
+										case_materials, MAX_ITERATIONS);
+			timer.stop();
+			timer.recordSplit("Batched fixed source iteration");
+
+			std::vector<int> num_iterations = solver.getBatchNumIterations();
+
+			for (unsigned int i = 0; i < batch_files.size(); i++) {
+				log_printf(RESULT, "%s: k_eff = %f", batch_files[i].c_str(),
+																k_effs[i]);
+				fprintf(summary, "%s %.8f %d %f\n", batch_files[i].c_str(),
+						k_effs[i], num_iterations[i], timer.getTime());
+			}
+		}
+
+		for (unsigned int i = 0; i < batch_files.size() &&
+											!batch_sweep; i++) {
+			log_printf(NORMAL, "Batch case %d: %s", i + 1,
+											batch_files[i].c_str());
+
+			solver.updateMaterials(updateMaterials(&parser, &geometry,
+												batch_files[i].c_str()));
+
+			timer.reset();
+			timer.start();
+			k_eff = solver.computeKeff(MAX_ITERATIONS);
+			timer.stop();
+			timer.recordSplit("Batch fixed source iteration");
+
+			log_printf(RESULT, "%s: k_eff = %f", batch_files[i].c_str(), k_eff);
+			fprintf(summary, "%s %.8f %d %f\n", batch_files[i].c_str(), k_eff,
+								solver.getNumIterations(), timer.getTime());
+		}
+
+		fclose(summary);
+		log_printf(NORMAL, "Wrote batch summary to %s",
+										opts.getBatchSummaryFile().c_str());
+	}
+
 	/* Print timer splits to console */
 	log_printf(NORMAL, "Program complete");
 	timer.printSplits();
+
+	if (counters != NULL) {
+		counters->printSplits();
+		delete counters;
+	}
+
+#if USE_MPI
+	MPI_Finalize();
+#endif
 }